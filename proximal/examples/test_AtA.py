@@ -0,0 +1,123 @@
+# Benchmark the fused A^T A Halide pipelines, versus calling A_* then At_*
+# back to back.
+import sys
+import importlib
+
+sys.path.append('../../')
+
+from proximal.utils.utils import *
+from proximal.halide.halide import *
+
+import numpy as np
+
+############################################################
+
+n_runs = 10
+
+
+def timeit(fn):
+    ''' Average run time of fn, in ms, after one warm-up run. '''
+    fn()
+    tic()
+    for _ in range(n_runs):
+        fn()
+    return toc() / n_runs
+
+
+def report(name, t_separate, t_fused, output_ref, output):
+    delta = np.linalg.norm(output_ref.ravel() - output.ravel(), np.inf)
+    norm = np.amax(np.abs(output_ref))
+    print('{0}: A then At took {1:.1f}ms, fused AtA took {2:.1f}ms ({3:.2f}x), '
+          'relative error {4}'.format(name, t_separate, t_fused,
+                                      t_separate / t_fused, delta / norm))
+
+
+# Load image
+np_img = get_test_image(2048)
+print('Type ', np_img.dtype, 'Shape', np_img.shape)
+
+mask = np.asfortranarray(np.random.rand(*np_img.shape), dtype=np.float32)
+MtM = np.asfortranarray(mask * mask, dtype=np.float32)
+
+tmp = np.empty(np_img.shape, dtype=np.float32, order='F')
+tmp_masked = np.empty(np_img.shape, dtype=np.float32, order='F')
+output_ref = np.empty(np_img.shape, dtype=np.float32, order='F')
+output = np.empty(np_img.shape, dtype=np.float32, order='F')
+
+############################################################################
+# Mask
+############################################################################
+
+for func in ('A_mask', 'At_mask', 'AtA_mask'):
+    Halide(func, recompile=True)  # Force recompile
+
+
+def separate_mask():
+    Halide('A_mask').A_mask(np_img, mask, tmp)
+    Halide('At_mask').At_mask(tmp, mask, output_ref)
+
+
+def fused_mask():
+    Halide('AtA_mask').AtA_mask(np_img, mask, output)
+
+
+report('Mask', timeit(separate_mask), timeit(fused_mask), output_ref, output)
+
+############################################################################
+# Convolution and mask
+############################################################################
+
+for func in ('A_conv', 'At_conv', 'AtA_conv'):
+    Halide(func, recompile=True)  # Force recompile
+
+# Compare with the direct convolution, which AtA_conv fuses.
+for func in ('A_conv', 'At_conv'):
+    importlib.import_module(
+        'proximal.halide.build.{}'.format(func)).set_method('direct')
+
+for kernel_size in (5, 11):
+    K = np.asfortranarray(np.random.rand(kernel_size, kernel_size),
+                          dtype=np.float32)
+    K /= K.sum()
+
+    def separate_conv():
+        Halide('A_conv').A_conv(np_img, K, tmp)
+        Halide('A_mask').A_mask(tmp, mask, tmp_masked)
+        Halide('At_mask').At_mask(tmp_masked, mask, tmp)
+        Halide('At_conv').At_conv(tmp, K, output_ref)
+
+    def fused_conv():
+        Halide('AtA_conv').AtA_conv(np_img, K, MtM, output)
+
+    report('Convolution {0}x{0} and mask'.format(kernel_size),
+           timeit(separate_conv), timeit(fused_conv), output_ref, output)
+
+############################################################################
+# Warp and mask
+############################################################################
+
+for func in ('A_warp', 'At_warp', 'AtA_warp'):
+    Halide(func, recompile=True)  # Force recompile
+
+theta_rad = 5.0 * np.pi / 180.0
+H = np.array([[np.cos(theta_rad), -np.sin(theta_rad), -128.],
+              [np.sin(theta_rad), np.cos(theta_rad), 0.], [0., 0., 1.]],
+             dtype=np.float32,
+             order='F')
+Hinv = np.asfortranarray(np.linalg.pinv(H))
+
+warped = np.empty((*np_img.shape, 1, 1), dtype=np.float32, order='F')
+
+
+def separate_warp():
+    Halide('A_warp').A_warp(np_img, H, warped)
+    warped[:, :, 0, 0] *= MtM
+    Halide('At_warp').At_warp(warped, Hinv, output_ref)
+
+
+def fused_warp():
+    Halide('AtA_warp').AtA_warp(np_img, H, Hinv, MtM, output)
+
+
+report('Warp and mask', timeit(separate_warp), timeit(fused_warp), output_ref,
+       output)
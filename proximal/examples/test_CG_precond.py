@@ -0,0 +1,68 @@
+# Benchmark the preconditioners of the conjugate gradient in the Halide
+# pipeline prox_CG_conv, on masked deblurring: iterations and wall time to a
+# fixed relative residual.
+import sys
+import importlib
+
+sys.path.append('../../')
+
+from proximal.utils.utils import *
+from proximal.halide.halide import *
+
+import numpy as np
+
+############################################################
+
+tol = 1e-4
+max_iters = 1000
+beta = 100.0
+
+# Load image, of the size of a precompiled FFT plan for the circulant
+# preconditioner.
+np_img = get_test_image(512)
+print('Type ', np_img.dtype, 'Shape', np_img.shape)
+
+K = get_kernel(15, 2)
+
+output = np.empty(np_img.shape, dtype=np.float32, order='F')
+blurred = np.empty(np_img.shape, dtype=np.float32, order='F')
+Atb = np.empty(np_img.shape, dtype=np.float32, order='F')
+
+for func in ('A_conv', 'At_conv', 'prox_CG_conv'):
+    Halide(func, recompile=True)  # Force recompile
+
+prox_CG_conv = importlib.import_module('proximal.halide.build.prox_CG_conv')
+
+Halide('A_conv').A_conv(np_img, K, blurred)
+
+# Masks from mildly to badly conditioned: random pixels missing, and a
+# vignetting mask with a dark corner.
+np.random.seed(1)
+xx, yy = np.meshgrid(np.linspace(0, 1, np_img.shape[1]),
+                     np.linspace(0, 1, np_img.shape[0]))
+masks = {
+    '10% missing': np.random.rand(*np_img.shape) > 0.1,
+    '50% missing': np.random.rand(*np_img.shape) > 0.5,
+    'vignetting': np.exp(-4.0 * (xx**2 + yy**2)),
+}
+
+for name, mask in masks.items():
+    mask = np.asfortranarray(mask, dtype=np.float32)
+    MtM = np.asfortranarray(mask * mask)
+
+    # Noisy, masked observation b, and A^T b
+    b = np.asfortranarray(mask * (blurred + 0.01 * np.random.randn(*np_img.shape)),
+                          dtype=np.float32)
+    Halide('At_conv').At_conv(np.asfortranarray(mask * b), K, Atb)
+
+    for preconditioner in ('none', 'jacobi', 'circulant'):
+        tic()
+        Halide('prox_CG_conv').prox_CG_conv(b, Atb, K, MtM, beta, output,
+                                            max_iters, tol, preconditioner)
+        elapsed = toc()
+
+        stats = prox_CG_conv.solve_stats()
+        print('{0}, {1} preconditioner: {2} iterations, {3:.1f}ms, '
+              'relative residual {4:.2e}'.format(
+                  name, preconditioner, stats['iterations'], elapsed,
+                  stats['norm_r'] / stats['norm_r0']))
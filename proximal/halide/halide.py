@@ -93,10 +93,14 @@ class Halide:
             'proximal.halide.build.{}'.format(self.module_name))
 
         if self.module_name[:4] == 'fft2':
-            expected_shape = (launch.htarget, launch.wtarget)
-            if np.any(expected_shape != self.target_shape):
-                print(f'Warning: FFT2 shape mismatch. Expected {expected_shape}, found {self.target_shape}. Please recompile.')
-
+            # One FFT plan is precompiled per size in the meson option
+            # fft_sizes. The plan is selected by the image size at run time.
+            precompiled_shapes = [tuple(shape) for shape in launch.sizes]
+            if tuple(self.target_shape) not in precompiled_shapes:
+                print(f'Warning: FFT2 shape {self.target_shape} is not precompiled. '
+                      f'Expected one of {precompiled_shapes}. Please add it to -Dfft_sizes and recompile.')
+
+            expected_shape = tuple(self.target_shape)
             if np.any(expected_shape != args[0].shape):
                 print('Warning: Input image shape mismatch for FFT2. '
                       f'Expected {expected_shape}, found {args[0].shape}. Applying circular boundary condition.')
@@ -1,8 +1,16 @@
 #include "util.hpp"
+#include "conv_dispatch.hpp"
 #include "convImg.h"
+#include "convImgFFT.h"
+#include "convImgSep.h"
 
 namespace proximal {
 
+/** Direct, separable or overlap-save FFT convolution, by the estimated run
+ * time. */
+ConvDispatch A_conv_dispatch{convImg, convImgSep, convImgFFT,
+                             "proximal.halide.build.At_conv"};
+
 int A_conv_glue(const array_float_t input, const array_float_t K,
     array_float_t output) {
 
@@ -10,7 +18,7 @@ int A_conv_glue(const array_float_t input, const array_float_t K,
         auto K_buf = getHalideBuffer<3>(K);
         auto output_buf = getHalideBuffer<3>(output, true);
 
-        const int success = convImg(input_buf, K_buf, output_buf);
+        const int success = A_conv_dispatch.run(input_buf, K_buf, output_buf);
         output_buf.copy_to_host();
         return success;
     }
@@ -19,4 +27,5 @@ int A_conv_glue(const array_float_t input, const array_float_t K,
 
 PYBIND11_MODULE(A_conv, m) {
     m.def("run", &proximal::A_conv_glue, "Apply 2D convolution");
+    proximal::A_conv_dispatch.bind(m);
 }
\ No newline at end of file
@@ -0,0 +1,22 @@
+#include "util.hpp"
+#include "convImgFFT.h"
+
+namespace proximal {
+
+int A_conv_fft_glue(const array_float_t input, const array_float_t K,
+    array_float_t output) {
+
+        auto input_buf = getHalideBuffer<3>(input);
+        auto K_buf = getHalideBuffer<3>(K);
+        auto output_buf = getHalideBuffer<3>(output, true);
+
+        const int success = convImgFFT(input_buf, K_buf, output_buf);
+        output_buf.copy_to_host();
+        return success;
+    }
+
+} // proximal
+
+PYBIND11_MODULE(A_conv_fft, m) {
+    m.def("run", &proximal::A_conv_fft_glue, "Apply 2D convolution, in overlapping tiles via FFT");
+}
@@ -0,0 +1,23 @@
+#include "util.hpp"
+#include "convImgSV.h"
+
+namespace proximal {
+
+int A_conv_sv_glue(const array_float_t input, const array_float_t K,
+    const array_float_t W, array_float_t output) {
+
+        auto input_buf = getHalideBuffer<3>(input);
+        auto K_buf = getHalideBuffer<3>(K);
+        auto W_buf = getHalideBuffer<3>(W);
+        auto output_buf = getHalideBuffer<3>(output, true);
+
+        const int success = convImgSV(input_buf, K_buf, W_buf, output_buf);
+        output_buf.copy_to_host();
+        return success;
+    }
+
+} // proximal
+
+PYBIND11_MODULE(A_conv_sv, m) {
+    m.def("run", &proximal::A_conv_sv_glue, "Apply 2D spatially varying convolution");
+}
\ No newline at end of file
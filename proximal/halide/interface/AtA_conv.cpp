@@ -0,0 +1,23 @@
+#include "util.hpp"
+#include "convImgAtA.h"
+
+namespace proximal {
+
+int AtA_conv_glue(const array_float_t input, const array_float_t K,
+    const array_float_t MtM, array_float_t output) {
+
+        auto input_buf = getHalideBuffer<3>(input);
+        auto K_buf = getHalideBuffer<3>(K);
+        auto MtM_buf = getHalideBuffer<3>(MtM);
+        auto output_buf = getHalideBuffer<3>(output, true);
+
+        const int success = convImgAtA(input_buf, K_buf, MtM_buf, output_buf);
+        output_buf.copy_to_host();
+        return success;
+    }
+
+} // proximal
+
+PYBIND11_MODULE(AtA_conv, m) {
+    m.def("run", &proximal::AtA_conv_glue, "Apply 2D convolution, mask and adjoint convolution");
+}
\ No newline at end of file
@@ -0,0 +1,22 @@
+#include "util.hpp"
+#include "WImgAtA.h"
+
+namespace proximal {
+
+int AtA_mask(const array_float_t input, const array_float_t mask,
+    array_float_t output) {
+
+        auto input_buf = getHalideBuffer<3>(input);
+        auto mask_buf = getHalideBuffer<3>(mask);
+        auto output_buf = getHalideBuffer<3>(output, true);
+
+        const bool success = WImgAtA(input_buf, mask_buf, output_buf);
+        output_buf.copy_to_host();
+        return success;
+    }
+
+} // proximal
+
+PYBIND11_MODULE(AtA_mask, m) {
+    m.def("run", &proximal::AtA_mask, "Apply squared elementwise multiplication");
+}
\ No newline at end of file
@@ -0,0 +1,24 @@
+#include "util.hpp"
+#include "warpImgAtA.h"
+
+namespace proximal {
+
+int AtA_warp_glue(const array_float_t input, const array_float_t H,
+    const array_float_t Hinv, const array_float_t MtM, array_float_t output) {
+
+        auto input_buf = getHalideBuffer<3>(input);
+        auto H_buf = getHalideBuffer<3>(H);
+        auto Hinv_buf = getHalideBuffer<3>(Hinv);
+        auto MtM_buf = getHalideBuffer<3>(MtM);
+        auto output_buf = getHalideBuffer<3>(output, true);
+
+        const bool success = warpImgAtA(input_buf, H_buf, Hinv_buf, MtM_buf, output_buf);
+        output_buf.copy_to_host();
+        return success;
+    }
+
+} // proximal
+
+PYBIND11_MODULE(AtA_warp, m) {
+    m.def("run", &proximal::AtA_warp_glue, "Apply affine transform, mask and inverse affine transform");
+}
\ No newline at end of file
@@ -0,0 +1,23 @@
+#include "util.hpp"
+#include "convImgSVT.h"
+
+namespace proximal {
+
+int At_conv_sv_glue(const array_float_t input, const array_float_t K,
+    const array_float_t W, array_float_t output) {
+
+        auto input_buf = getHalideBuffer<3>(input);
+        auto K_buf = getHalideBuffer<3>(K);
+        auto W_buf = getHalideBuffer<3>(W);
+        auto output_buf = getHalideBuffer<3>(output, true);
+
+        const int success = convImgSVT(input_buf, K_buf, W_buf, output_buf);
+        output_buf.copy_to_host();
+        return success;
+    }
+
+} // proximal
+
+PYBIND11_MODULE(At_conv_sv, m) {
+    m.def("run", &proximal::At_conv_sv_glue, "Apply 2D adjoint spatially varying convolution");
+}
\ No newline at end of file
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <pybind11/pybind11.h>
+
+#include <functional>
+#include <stdexcept>
+#include <utility>
+
+#include "HalideBuffer.h"
+
+namespace py = pybind11;
+
+namespace {
+
+/** Conjugate gradient (CG) run time, calling one pipeline per iteration.
+ *
+ * The pipelines <name>_init and <name>_step compute the initial residual, and
+ * one CG step with the scalar state rho of the previous step, respectively.
+ * The optional preconditioner pipeline runs on the residual before each step.
+ * The iterations stop as soon as the L2 norm of the residual drops below the
+ * relative tolerance, instead of running a fixed number of steps.
+ */
+class CgRuntime {
+   public:
+    /** precond(r, z) solves the preconditioner for z. Empty for the plain CG,
+     * i.e. z = r. */
+    using precond_t =
+        std::function<int(Halide::Runtime::Buffer<float>&, Halide::Runtime::Buffer<float>&)>;
+
+    /** Solve for x, starting from the value of x on input.
+     *
+     * init(r, norm_r) computes the initial residual r of x, and its norm;
+     * step(x, r, z, p, rho_prev, x_next, r_next, p_next, rho, norm_r) one CG
+     * step. Returns the first non-zero error code of the pipelines.
+     */
+    template <typename InitT, typename StepT>
+    int solve(Halide::Runtime::Buffer<float>& x, InitT&& init, const precond_t& precond,
+              StepT&& step, const int max_iters, const float tol) {
+        using Halide::Runtime::Buffer;
+
+        if (max_iters < 0 || tol < 0.0f) {
+            throw std::invalid_argument("Expected non-negative max_iters and tol");
+        }
+
+        const int width = x.dim(0).extent();
+        const int height = x.dim(1).extent();
+        const int channels = x.dim(2).extent();
+
+        Buffer<float> x_next(width, height, channels);
+        Buffer<float> r(width, height, channels);
+        Buffer<float> r_next(width, height, channels);
+        Buffer<float> p(width, height, channels);
+        Buffer<float> p_next(width, height, channels);
+
+        // Preconditioned residual, if any
+        Buffer<float> z;
+        if (precond) {
+            z = Buffer<float>(width, height, channels);
+        }
+
+        // Not read in the first step, as rho_prev = 0, but must be finite.
+        p.fill(0.0f);
+
+        auto rho = Buffer<float, 0>::make_scalar();
+        auto norm_r = Buffer<float, 0>::make_scalar();
+
+        last_iterations = 0;
+        if (const int error = init(r, norm_r)) {
+            return error;
+        }
+        last_norm_r0 = last_norm_r = norm_r();
+
+        float rho_prev = 0.0f;
+        while (last_iterations < max_iters && last_norm_r > tol * last_norm_r0) {
+            if (precond) {
+                if (const int error = precond(r, z)) {
+                    return error;
+                }
+            }
+            if (const int error = step(x, r, precond ? z : r, p, rho_prev, x_next, r_next, p_next,
+                                       rho, norm_r)) {
+                return error;
+            }
+            std::swap(x, x_next);
+            std::swap(r, r_next);
+            std::swap(p, p_next);
+
+            rho_prev = rho();
+            last_norm_r = norm_r();
+            last_iterations++;
+        }
+        return 0;
+    }
+
+    void bind(py::module& m) {
+        m.def(
+            "solve_stats",
+            [this]() {
+                py::dict d;
+                d["iterations"] = last_iterations;
+                d["norm_r0"] = last_norm_r0;
+                d["norm_r"] = last_norm_r;
+                return d;
+            },
+            "Number of CG steps and the residual norms, initial and final, of the last call");
+    }
+
+   private:
+    int last_iterations = 0;
+    float last_norm_r0 = 0.0f;
+    float last_norm_r = 0.0f;
+};
+
+}  // namespace
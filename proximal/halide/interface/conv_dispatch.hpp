@@ -0,0 +1,379 @@
+#pragma once
+
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+
+#include "HalideBuffer.h"
+#include "frequency_cache.hpp"
+#include "separable_kernel.hpp"
+#include "util.hpp"
+
+namespace py = pybind11;
+
+#if !defined(CONFIG_CONV_FFT_TILE_SIZE) || !defined(CONFIG_CONV_FFT_MAX_KERNEL_SIZE)
+#error Tiles of the FFT convolution must be defined with -DCONFIG_CONV_FFT_TILE_SIZE=... -DCONFIG_CONV_FFT_MAX_KERNEL_SIZE=... in the compile command.
+#endif
+
+namespace {
+
+enum class ConvMethod { direct, separable, fft };
+
+/** Estimated run time of the convolution pipelines, in nanoseconds.
+ *
+ * The default coefficients are placeholders only. ConvDispatch replaces them
+ * by the run time measured on the host before the first automatic selection,
+ * see ConvDispatch::calibrate(). Coefficients set with set_cost_model(), e.g.
+ * as reported by benchmark-conv, are kept as they are.
+ */
+struct ConvCostModel {
+    /** Direct summation, per output pixel and kernel tap. */
+    double direct_per_tap = 0.02;
+
+    /** Two-pass separable convolution, per output pixel, rank and tap of the
+     * horizontal and vertical factors. */
+    double separable_per_tap = 0.03;
+
+    /** Overlap-save FFT, per tile pixel, for the forward and the inverse
+     * transform and the product of the spectra. */
+    double fft_per_tile_pixel = 1.5;
+
+    static constexpr int tile_size = CONFIG_CONV_FFT_TILE_SIZE;
+    static constexpr int max_kernel_size = CONFIG_CONV_FFT_MAX_KERNEL_SIZE;
+
+    double direct(const int width, const int height, const int channels,
+                  const int width_kernel, const int height_kernel) const {
+        return double(width) * height * channels * width_kernel * height_kernel * direct_per_tap;
+    }
+
+    double separable(const int width, const int height, const int channels,
+                     const int width_kernel, const int height_kernel, const int rank) const {
+        return double(width) * height * channels * rank * (width_kernel + height_kernel) *
+               separable_per_tap;
+    }
+
+    /** Each tile produces tile_size - max_kernel_size + 1 output pixels per
+     * dimension. One more tile per channel accounts for the kernel
+     * transform. */
+    double fft(const int width, const int height, const int channels) const {
+        constexpr int S = tile_size - max_kernel_size + 1;
+        const double n_tiles = double((width + S - 1) / S) * ((height + S - 1) / S) + 1;
+        return n_tiles * channels * tile_size * tile_size * fft_per_tile_pixel;
+    }
+};
+
+/** Select the convolution pipeline with the least estimated run time, by the
+ * image size, the kernel size and the kernel rank, unless overridden by the
+ * user.
+ *
+ * The rank is that of the singular value decomposition of the kernel, within
+ * the tolerance set by the user. The decomposition of the last kernel is
+ * cached, as the same kernel is applied in every iteration of the solver.
+ */
+class ConvDispatch {
+   public:
+    /** Pipelines convImg and convImgFFT, or their adjoints. */
+    using conv_t = int (*)(halide_buffer_t*, halide_buffer_t*, halide_buffer_t*);
+
+    /** Pipeline convImgSep. */
+    using conv_sep_t = int (*)(halide_buffer_t*, halide_buffer_t*, halide_buffer_t*,
+                               halide_buffer_t*);
+
+    /** With adjoint=true, decompose the flipped kernel, for At_conv.
+     *
+     * The peer is the Python module of the adjoint operator, i.e. At_conv for
+     * A_conv and vice versa, which shares the separable tolerance. The peer
+     * may not be built; if loaded later, it takes over the tolerance of this
+     * module then.
+     */
+    ConvDispatch(conv_t direct, conv_sep_t separable, conv_t fft, const char* peer,
+                 const bool adjoint = false)
+        : conv_direct(direct),
+          conv_separable(separable),
+          conv_fft(fft),
+          peer(peer),
+          adjoint(adjoint) {}
+
+    /** Convolve the input by the selected pipeline. */
+    int run(Halide::Runtime::Buffer<float>& input, Halide::Runtime::Buffer<float>& K,
+            Halide::Runtime::Buffer<float>& output) {
+        switch (select(input, K)) {
+            case ConvMethod::separable: {
+                auto& sep = separableKernel();
+                return conv_separable(input, sep.Kx, sep.Ky, output);
+            }
+            case ConvMethod::fft:
+                return conv_fft(input, K, output);
+            default:
+                return conv_direct(input, K, output);
+        }
+    }
+
+    ConvMethod select(const Halide::Runtime::Buffer<float>& input,
+                      const Halide::Runtime::Buffer<float>& K) {
+        const int width = input.dim(0).extent();
+        const int height = input.dim(1).extent();
+        const int channels = input.dim(2).extent();
+        const int width_kernel = K.dim(0).extent();
+        const int height_kernel = K.dim(1).extent();
+        const bool fft_supported = width_kernel <= ConvCostModel::max_kernel_size &&
+                                   height_kernel <= ConvCostModel::max_kernel_size;
+
+        if (forced) {
+            if (*forced == ConvMethod::fft && !fft_supported) {
+                throw std::invalid_argument(
+                    "Kernel size exceeds " + std::to_string(ConvCostModel::max_kernel_size) +
+                    " of the FFT convolution. Set the meson variable conv_fft_max_kernel_size.");
+            }
+            if (*forced == ConvMethod::separable) {
+                decompose(K);
+            }
+            return *forced;
+        }
+
+        if (!calibrated) {
+            calibrate();
+        }
+
+        ConvMethod method = ConvMethod::direct;
+        double cost = model.direct(width, height, channels, width_kernel, height_kernel);
+
+        const int rank = decompose(K).rank();
+        const double separable_cost =
+            model.separable(width, height, channels, width_kernel, height_kernel, rank);
+        if (separable_cost < cost) {
+            method = ConvMethod::separable;
+            cost = separable_cost;
+        }
+
+        if (fft_supported && model.fft(width, height, channels) < cost) {
+            method = ConvMethod::fft;
+        }
+        return method;
+    }
+
+    /** Factors of the kernel in the last call of select(), for the pipeline
+     * convImgSep. */
+    SeparableKernel& separableKernel() { return *decomposition; }
+
+    /** Measure the coefficients of the cost model on the host.
+     *
+     * Time each pipeline on a random image of 2 x 2 FFT tiles and a random
+     * kernel of rank 1. Each coefficient is the shortest of a few runs, after
+     * a warm-up run, divided by the cost of the pipeline at the coefficient 1.
+     */
+    void calibrate() {
+        using Halide::Runtime::Buffer;
+
+        constexpr int S = ConvCostModel::tile_size - ConvCostModel::max_kernel_size + 1;
+        constexpr int width = 2 * S;
+        constexpr int height = 2 * S;
+        constexpr int size_kernel = std::min(15, ConvCostModel::max_kernel_size);
+
+        std::mt19937 rng{42};
+        std::uniform_real_distribution<float> uniform{0.0f, 1.0f};
+        const auto random = [&](Buffer<float> b) {
+            b.for_each_value([&](float& v) { v = uniform(rng); });
+            return b;
+        };
+
+        Buffer<float> input = random(Buffer<float>(width, height, 1));
+        Buffer<float> Kx = random(Buffer<float>(size_kernel, 1, 1));
+        Buffer<float> Ky = random(Buffer<float>(size_kernel, 1, 1));
+        Buffer<float> K(size_kernel, size_kernel, 1);
+        K.for_each_element([&](int i, int j, int) { K(i, j, 0) = Kx(i, 0, 0) * Ky(j, 0, 0); });
+        Buffer<float> output(width, height, 1);
+
+        const auto runtime = [](const auto& conv) {
+            constexpr int samples = 3;
+
+            double best = std::numeric_limits<double>::infinity();
+            for (int i = 0; i <= samples; i++) {
+                const auto start = std::chrono::steady_clock::now();
+                if (conv() != 0) {
+                    throw std::runtime_error("Convolution pipeline failed in the calibration");
+                }
+                const std::chrono::duration<double, std::nano> elapsed =
+                    std::chrono::steady_clock::now() - start;
+
+                // The first run warms up the thread pool and the caches.
+                if (i > 0) {
+                    best = std::min(best, elapsed.count());
+                }
+            }
+            return best;
+        };
+
+        const ConvCostModel unit{1.0, 1.0, 1.0};
+        model.direct_per_tap = runtime([&]() { return conv_direct(input, K, output); }) /
+                               unit.direct(width, height, 1, size_kernel, size_kernel);
+        model.separable_per_tap =
+            runtime([&]() { return conv_separable(input, Kx, Ky, output); }) /
+            unit.separable(width, height, 1, size_kernel, size_kernel, 1);
+        model.fft_per_tile_pixel =
+            runtime([&]() { return conv_fft(input, K, output); }) / unit.fft(width, height, 1);
+        calibrated = true;
+    }
+
+    void bind(py::module& m) {
+        m.def(
+            "set_method",
+            [this](const std::string& method) {
+                if (method == "auto") {
+                    forced.reset();
+                } else if (method == "direct") {
+                    forced = ConvMethod::direct;
+                } else if (method == "separable") {
+                    forced = ConvMethod::separable;
+                } else if (method == "fft") {
+                    forced = ConvMethod::fft;
+                } else {
+                    throw std::invalid_argument("Unknown convolution method " + method +
+                                                ", expected 'auto', 'direct', 'separable' or 'fft'");
+                }
+            },
+            "Force the convolution method: 'auto', 'direct', 'separable' or 'fft'",
+            py::arg("method"));
+
+        m.def(
+            "method",
+            [this](const array_float_t& input, const array_float_t& K) {
+                const auto method = select(getHalideBuffer<3>(input), getHalideBuffer<3>(K));
+                switch (method) {
+                    case ConvMethod::separable:
+                        return "separable";
+                    case ConvMethod::fft:
+                        return "fft";
+                    default:
+                        return "direct";
+                }
+            },
+            "Convolution method selected for the image and the kernel", py::arg("input"),
+            py::arg("K"));
+
+        m.def(
+            "rank",
+            [this](const array_float_t& K) { return decompose(getHalideBuffer<3>(K)).rank(); },
+            "Rank of the kernel within the separable tolerance", py::arg("K"));
+
+        // A and A^T must approximate the same kernel to remain adjoint, so the
+        // tolerance is set in both modules: in the peer now, if loaded;
+        // otherwise, on the import of the peer.
+        m.def(
+            "set_separable_tolerance",
+            [this](double tol) {
+                if (tol < 0.0) {
+                    throw std::invalid_argument("Tolerance must be non-negative");
+                }
+                tolerance = tol;
+                if (const auto p = loadedPeer()) {
+                    p->attr("_set_separable_tolerance")(tol);
+                }
+            },
+            "Relative error of the low-rank kernel in the Frobenius norm, e.g. 1e-2 to "
+            "approximate a nearly separable kernel by a sum of few separable ones. Shared by "
+            "A_conv and At_conv",
+            py::arg("tolerance"));
+
+        m.def(
+            "_set_separable_tolerance", [this](double tol) { tolerance = tol; },
+            "Set the tolerance of this module only, for set_separable_tolerance of the peer",
+            py::arg("tolerance"));
+
+        m.def(
+            "cost_model",
+            [this]() {
+                py::dict d;
+                d["direct_per_tap"] = model.direct_per_tap;
+                d["separable_per_tap"] = model.separable_per_tap;
+                d["fft_per_tile_pixel"] = model.fft_per_tile_pixel;
+                d["tile_size"] = ConvCostModel::tile_size;
+                d["max_kernel_size"] = ConvCostModel::max_kernel_size;
+                d["separable_tolerance"] = tolerance;
+                d["calibrated"] = calibrated;
+                return d;
+            },
+            "Coefficients of the cost model, in nanoseconds");
+
+        m.def(
+            "calibrate", [this]() { calibrate(); },
+            "Measure the coefficients of the cost model on the host. Called before the first "
+            "automatic selection, unless the coefficients are set with set_cost_model");
+
+        m.def(
+            "set_cost_model",
+            [this](std::optional<double> direct_per_tap, std::optional<double> fft_per_tile_pixel,
+                   std::optional<double> separable_per_tap) {
+                model.direct_per_tap = direct_per_tap.value_or(model.direct_per_tap);
+                model.fft_per_tile_pixel = fft_per_tile_pixel.value_or(model.fft_per_tile_pixel);
+                model.separable_per_tap = separable_per_tap.value_or(model.separable_per_tap);
+                calibrated = true;
+            },
+            "Set the coefficients of the cost model, in nanoseconds, e.g. as reported by "
+            "benchmark-conv",
+            py::arg("direct_per_tap") = py::none(), py::arg("fft_per_tile_pixel") = py::none(),
+            py::arg("separable_per_tap") = py::none());
+
+        if (const auto p = loadedPeer()) {
+            tolerance = p->attr("cost_model")()["separable_tolerance"].cast<double>();
+        }
+    }
+
+   private:
+    /** The peer module, if already imported. */
+    std::optional<py::module> loadedPeer() const {
+        const py::dict modules = py::module::import("sys").attr("modules");
+        if (!modules.contains(peer)) {
+            return std::nullopt;
+        }
+        return modules[peer].cast<py::module>();
+    }
+
+    using decomposition_key_t = std::tuple<uint64_t, int, int, int, double>;
+
+    const SeparableKernel& decompose(const Halide::Runtime::Buffer<float>& K) {
+        const decomposition_key_t key{contentHash(K), K.dim(0).extent(), K.dim(1).extent(),
+                                      K.dim(2).extent(), tolerance};
+        if (!decomposition || key != decomposition_key) {
+            decomposition = decomposeKernel(K, tolerance, adjoint);
+            decomposition_key = key;
+        }
+        return *decomposition;
+    }
+
+    conv_t conv_direct;
+    conv_sep_t conv_separable;
+    conv_t conv_fft;
+
+    /** Python module of the adjoint operator. */
+    const char* peer;
+
+    ConvCostModel model;
+
+    /** Whether the coefficients of the model are measured, or set by the user. */
+    bool calibrated = false;
+
+    /** Method overridden by the user, or automatic if empty. */
+    std::optional<ConvMethod> forced;
+
+    const bool adjoint;
+
+    /** Relative tolerance of the rank, by default of the order of the float
+     * precision, i.e. exactly separable kernels only. */
+    double tolerance = 1e-6;
+
+    decomposition_key_t decomposition_key;
+    std::optional<SeparableKernel> decomposition;
+};
+
+}  // namespace
@@ -1,18 +1,64 @@
+#include <stdexcept>
+#include <string>
+
+#include "fft_plan.hpp"
 #include "util.hpp"
-#include "fftR2CImg.h"
+
+#define X(W, H) FFT_PLAN_DECLARE(fftR2CImg, W, H)
+CONFIG_FFT_PLANS(X)
+#undef X
 
 namespace proximal {
 
 constexpr int32_t wtarget{CONFIG_FFT_WIDTH};
 constexpr int32_t htarget{CONFIG_FFT_HEIGHT};
 
-int fft2_r2c_glue(const array_float_t input, const int xshift,
-    const int yshift, array_cxfloat_t output) {
+const FftPlans fft2_r2c_plans{
+#define X(W, H) FFT_PLAN_ENTRY(fftR2CImg, W, H)
+    CONFIG_FFT_PLANS(X)
+#undef X
+};
+
+int fft2_r2c_glue(const array_float_t input, int xshift,
+    int yshift, array_cxfloat_t output) {
 
         auto input_buf = getHalideBuffer<3>(input);
         auto output_buf = getHalideComplexBuffer<4>(output, true);
 
-        return fftR2CImg(input_buf, xshift, yshift, output_buf);
+        // The Hermitian symmetric output has (H + 1) / 2 + 1 rows, for the
+        // image height H either even, or odd and one less. Take the input height if it is either
+        // one. A smaller input, e.g. a blur kernel zero-padded to the image
+        // size, only matches the plan of one of them.
+        const int width = output_buf.dim(1).extent();
+        const int height_even = (output_buf.dim(2).extent() - 1) * 2;
+        const int height_odd = height_even - 1;
+        const int height_input = input_buf.dim(1).extent();
+
+        const bool is_image = (height_input == height_even || height_input == height_odd);
+
+        fft_plan_t plan = nullptr;
+        if (is_image) {
+            plan = fft2_r2c_plans.find(width, height_input);
+        } else {
+            const auto plan_even = fft2_r2c_plans.find(width, height_even);
+            const auto plan_odd = fft2_r2c_plans.find(width, height_odd);
+            if (plan_even != nullptr && plan_odd != nullptr) {
+                throw std::invalid_argument(
+                    "FFT plans of sizes " + std::to_string(width) + "x" +
+                    std::to_string(height_even) + " and " + std::to_string(width) + "x" +
+                    std::to_string(height_odd) + " match the output; pad the input of height " +
+                    std::to_string(height_input) + " to the image height.");
+            }
+            plan = (plan_even != nullptr) ? plan_even : plan_odd;
+        }
+
+        if (plan == nullptr) {
+            throw std::invalid_argument(
+                FftPlans::notFound(width, is_image ? height_input : height_even));
+        }
+
+        void* args[] = {input_buf.raw_buffer(), &xshift, &yshift, output_buf.raw_buffer()};
+        return plan(args);
     }
 
 } // proximal
@@ -21,4 +67,5 @@ PYBIND11_MODULE(fft2_r2c, m) {
     m.def("run", &proximal::fft2_r2c_glue, "Apply 2D adjoint convolution");
     m.attr("wtarget") = pybind11::int_(proximal::wtarget);
     m.attr("htarget") = pybind11::int_(proximal::htarget);
-}
\ No newline at end of file
+    m.attr("sizes") = proximal::fft2_r2c_plans.sizes();
+}
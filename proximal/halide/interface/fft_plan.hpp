@@ -0,0 +1,68 @@
+#pragma once
+
+#include <pybind11/pybind11.h>
+
+#include <initializer_list>
+#include <map>
+#include <string>
+#include <utility>
+
+namespace py = pybind11;
+
+#ifndef CONFIG_FFT_PLANS
+#error List of FFT plans must be defined with -DCONFIG_FFT_PLANS(X)="X(W, H) ..." in the compile command.
+#endif
+
+namespace {
+
+/** The argv entry point of a precompiled FFT pipeline, e.g. fftR2CImg_512x512_argv(). */
+using fft_plan_t = int (*)(void**);
+
+/** FFT pipelines precompiled for the image sizes in the meson option fft_sizes.
+ *
+ * The radix factors of the FFT are determined at compile time, so there is one
+ * pipeline per image size. Look up the pipeline by the image size at run time,
+ * so that one shared library serves all precompiled sizes without a meson
+ * reconfigure. The table is immutable, hence safe to read from any thread.
+ */
+class FftPlans {
+   public:
+    using plan_size_t = std::pair<int, int>;
+
+    FftPlans(std::initializer_list<std::pair<const plan_size_t, fft_plan_t>> plans) : plans(plans) {}
+
+    /** Return the pipeline of the image size width x height, or nullptr if
+     * not precompiled. */
+    fft_plan_t find(const int width, const int height) const {
+        const auto it = plans.find({width, height});
+        return (it == plans.end()) ? nullptr : it->second;
+    }
+
+    /** List of precompiled image sizes, in the form of (height, width) as in
+     * the NumPy array shape. */
+    py::list sizes() const {
+        py::list l;
+        for (const auto& [size, plan] : plans) {
+            l.append(py::make_tuple(size.second, size.first));
+        }
+        return l;
+    }
+
+    /** Error message for the image size without a precompiled plan. */
+    static std::string notFound(const int width, const int height) {
+        return "FFT plan of size " + std::to_string(width) + "x" + std::to_string(height) +
+               " is not precompiled. Add it to the meson option fft_sizes.";
+    }
+
+   private:
+    const std::map<plan_size_t, fft_plan_t> plans;
+};
+
+}  // namespace
+
+/** Declare the argv entry points of the precompiled pipeline `name`, one per
+ * FFT plan. */
+#define FFT_PLAN_DECLARE(name, W, H) extern "C" int name##_##W##x##H##_argv(void**);
+
+/** Entry of the FftPlans table. */
+#define FFT_PLAN_ENTRY(name, W, H) {{W, H}, name##_##W##x##H##_argv},
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <pybind11/pybind11.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <list>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <tuple>
+#include <utility>
+
+#include "HalideBuffer.h"
+
+namespace py = pybind11;
+
+namespace {
+
+/** Fast, non-cryptographic 64-bit hash of the buffer contents.
+ *
+ * Multiply-xorshift over 8-byte words, in four independent lanes to hide the
+ * multiplication latency. The buffer must be dense.
+ */
+inline uint64_t
+contentHash(const Halide::Runtime::Buffer<float>& buf) {
+    constexpr uint64_t k = 0x9e3779b97f4a7c15ull;
+
+    const auto* bytes = reinterpret_cast<const uint8_t*>(buf.begin());
+    const size_t n_bytes = buf.size_in_bytes();
+
+    uint64_t lanes[4] = {n_bytes, n_bytes ^ k, n_bytes + k, ~n_bytes};
+    const auto mix = [](uint64_t h, uint64_t w) {
+        h = (h ^ w) * k;
+        return h ^ (h >> 29);
+    };
+
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) * 4 <= n_bytes; i += sizeof(uint64_t) * 4) {
+        for (int lane = 0; lane < 4; lane++) {
+            uint64_t w;
+            std::memcpy(&w, bytes + i + lane * sizeof(uint64_t), sizeof(w));
+            lanes[lane] = mix(lanes[lane], w);
+        }
+    }
+
+    // Remaining words, and the trailing bytes.
+    for (; i < n_bytes; i += sizeof(uint64_t)) {
+        uint64_t w = 0;
+        std::memcpy(&w, bytes + i, std::min(sizeof(w), n_bytes - i));
+        lanes[0] = mix(lanes[0], w);
+    }
+
+    uint64_t h = lanes[0];
+    for (int lane = 1; lane < 4; lane++) {
+        h = mix(h, lanes[lane]);
+    }
+    return h;
+}
+
+/** Cache of the Fourier-transformed inputs of the least_square_direct pipeline.
+ *
+ * The spectrum is keyed by the content hash of the input, or by a problem
+ * handle provided by the caller, together with the FFT size. The least
+ * recently used spectra are evicted when the total size exceeds the capacity.
+ *
+ * On a cache hit, the pipeline reads the cached spectrum, and exports nothing:
+ * pass exportBuffer() as its output_spectrum.
+ */
+class FrequencyCache {
+   public:
+    /** Content hash or problem handle, whether it is a handle, width and
+     * height of the input, width and height of the FFT, and number of
+     * channels. */
+    using key_t = std::tuple<uint64_t, bool, int, int, int, int, int>;
+
+    explicit FrequencyCache(size_t capacity) : capacity(capacity) {}
+
+    /** Key of the input, by the problem handle if provided; otherwise, by the
+     * content hash. Handles and hashes never collide. The input shape tells
+     * apart the same bytes, e.g. of 100x200 and 200x100 images, padded to the
+     * same FFT size. */
+    static key_t makeKey(const Halide::Runtime::Buffer<float>& input, std::optional<uint64_t> handle,
+                         int width, int height) {
+        const bool is_handle = handle.has_value();
+        return {is_handle ? *handle : contentHash(input),
+                is_handle,
+                input.dim(0).extent(),
+                input.dim(1).extent(),
+                width,
+                height,
+                input.dim(2).extent()};
+    }
+
+    /** Output spectrum of the pipeline: the spectrum to be cached on a miss;
+     * otherwise, an empty buffer of zero channels, to skip the export. */
+    static Halide::Runtime::Buffer<float> exportBuffer(Halide::Runtime::Buffer<float>& spectrum,
+                                                       bool is_cached) {
+        if (!is_cached) {
+            return spectrum;
+        }
+        return Halide::Runtime::Buffer<float>(spectrum.dim(0).extent(), spectrum.dim(1).extent(),
+                                              spectrum.dim(2).extent(), 0);
+    }
+
+    /** Return the cached spectrum, and true; or a newly allocated spectrum
+     * buffer to be filled by the pipeline, and false. */
+    std::pair<Halide::Runtime::Buffer<float>, bool> acquire(const key_t& key) {
+        const std::lock_guard<std::mutex> lock(mutex);
+
+        const auto it = index.find(key);
+        if (it != index.end()) {
+            hits++;
+            entries.splice(entries.begin(), entries, it->second);
+            return {it->second->second, true};
+        }
+
+        misses++;
+        const auto [hash, is_handle, input_width, input_height, width, height, n_channels] = key;
+        return {Halide::Runtime::Buffer<float>(2, width, (height + 1) / 2 + 1, n_channels), false};
+    }
+
+    /** Cache the spectrum computed by the pipeline. */
+    void insert(const key_t& key, Halide::Runtime::Buffer<float> spectrum) {
+        const std::lock_guard<std::mutex> lock(mutex);
+
+        if (index.count(key) != 0 || spectrum.size_in_bytes() > capacity) {
+            return;
+        }
+
+        entries.emplace_front(key, std::move(spectrum));
+        index[key] = entries.begin();
+        size += entries.front().second.size_in_bytes();
+        evict();
+    }
+
+    void clear() {
+        const std::lock_guard<std::mutex> lock(mutex);
+
+        entries.clear();
+        index.clear();
+        size = 0;
+        hits = 0;
+        misses = 0;
+        evictions = 0;
+    }
+
+    void setCapacity(size_t bytes) {
+        const std::lock_guard<std::mutex> lock(mutex);
+
+        capacity = bytes;
+        evict();
+    }
+
+    /** Hit and miss counters, and the memory usage, in bytes. */
+    py::dict stats() const {
+        const std::lock_guard<std::mutex> lock(mutex);
+
+        py::dict d;
+        d["hits"] = hits;
+        d["misses"] = misses;
+        d["evictions"] = evictions;
+        d["entries"] = entries.size();
+        d["size"] = size;
+        d["capacity"] = capacity;
+        return d;
+    }
+
+    /** Expose the cache to Python, as functions of the module m. */
+    void bind(py::module& m) {
+        m.def("cache_stats", [this]() { return stats(); }, "Frequency cache hit/miss counters");
+        m.def("cache_clear", [this]() { clear(); }, "Clear the frequency cache");
+        m.def("set_cache_capacity", [this](size_t bytes) { setCapacity(bytes); },
+              "Set the frequency cache capacity, in bytes");
+    }
+
+   private:
+    using entry_t = std::pair<key_t, Halide::Runtime::Buffer<float>>;
+
+    /** Remove the least recently used spectra, until within the capacity. */
+    void evict() {
+        while (size > capacity && !entries.empty()) {
+            size -= entries.back().second.size_in_bytes();
+            index.erase(entries.back().first);
+            entries.pop_back();
+            evictions++;
+        }
+    }
+
+    std::list<entry_t> entries;  //!< Most recently used first.
+    std::map<key_t, std::list<entry_t>::iterator> index;
+
+    size_t capacity;
+    size_t size = 0;
+
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t evictions = 0;
+
+    mutable std::mutex mutex;
+};
+
+}  // namespace
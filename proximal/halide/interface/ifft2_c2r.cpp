@@ -1,17 +1,39 @@
+#include <stdexcept>
+
+#include "fft_plan.hpp"
 #include "util.hpp"
-#include "ifftC2RImg.h"
+
+#define X(W, H) FFT_PLAN_DECLARE(ifftC2RImg, W, H)
+CONFIG_FFT_PLANS(X)
+#undef X
 
 namespace proximal {
 
 constexpr int32_t wtarget{CONFIG_FFT_WIDTH};
 constexpr int32_t htarget{CONFIG_FFT_HEIGHT};
 
+const FftPlans ifft2_c2r_plans{
+#define X(W, H) FFT_PLAN_ENTRY(ifftC2RImg, W, H)
+    CONFIG_FFT_PLANS(X)
+#undef X
+};
+
 int ifft2_c2r_glue(const array_cxfloat_t input, array_float_t output) {
 
         auto input_buf = getHalideComplexBuffer<4>(input);
         auto output_buf = getHalideBuffer<3>(output, true);
 
-        return ifftC2RImg(input_buf, output_buf);
+        // Select the plan by the output image size.
+        const int width = output_buf.dim(0).extent();
+        const int height = output_buf.dim(1).extent();
+
+        const auto plan = ifft2_c2r_plans.find(width, height);
+        if (plan == nullptr) {
+            throw std::invalid_argument(FftPlans::notFound(width, height));
+        }
+
+        void* args[] = {input_buf.raw_buffer(), output_buf.raw_buffer()};
+        return plan(args);
     }
 
 } // proximal
@@ -20,4 +42,5 @@ PYBIND11_MODULE(ifft2_c2r, m) {
     m.def("run", &proximal::ifft2_c2r_glue, "Apply 2D ifft");
     m.attr("wtarget") = pybind11::int_(proximal::wtarget);
     m.attr("htarget") = pybind11::int_(proximal::htarget);
-}
\ No newline at end of file
+    m.attr("sizes") = proximal::ifft2_c2r_plans.sizes();
+}
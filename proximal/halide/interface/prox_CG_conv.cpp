@@ -0,0 +1,122 @@
+#include <pybind11/pybind11.h>
+
+#include <stdexcept>
+#include <string>
+
+#include "util.hpp"
+#include "cg_runtime.hpp"
+#include "fft_plan.hpp"
+#include "CG_conv_init.h"
+#include "CG_conv_step.h"
+#include "CG_conv_jacobi.h"
+#include "CG_diag_precond.h"
+
+#define X(W, H) FFT_PLAN_DECLARE(CG_conv_circulant, W, H) FFT_PLAN_DECLARE(CG_circulant_precond, W, H)
+CONFIG_FFT_PLANS(X)
+#undef X
+
+namespace proximal {
+
+const FftPlans CG_conv_circulant_plans{
+#define X(W, H) FFT_PLAN_ENTRY(CG_conv_circulant, W, H)
+    CONFIG_FFT_PLANS(X)
+#undef X
+};
+
+const FftPlans CG_circulant_precond_plans{
+#define X(W, H) FFT_PLAN_ENTRY(CG_circulant_precond, W, H)
+    CONFIG_FFT_PLANS(X)
+#undef X
+};
+
+CgRuntime prox_CG_conv_runtime;
+
+int prox_CG_conv_glue(const array_float_t input, const array_float_t Atb,
+    const array_float_t K, const array_float_t MtM, float beta,
+    array_float_t output, int max_iters, float tol, const std::string& preconditioner) {
+
+        using Halide::Runtime::Buffer;
+
+        auto input_buf = getHalideBuffer<3>(input);
+        auto Atb_buf = getHalideBuffer<3>(Atb);
+        auto K_buf = getHalideBuffer<3>(K);
+        auto MtM_buf = getHalideBuffer<3>(MtM);
+        auto output_buf = getHalideBuffer<3>(output, false);
+
+        const int width = input_buf.dim(0).extent();
+        const int height = input_buf.dim(1).extent();
+        const int channels = input_buf.dim(2).extent();
+
+        // The preconditioner is computed once per call, then applied in every
+        // CG step.
+        CgRuntime::precond_t precond;
+        Buffer<float> precond_buf;
+
+        if (preconditioner == "jacobi") {
+            precond_buf = Buffer<float>(width, height, channels);
+            if (const int error = CG_conv_jacobi(K_buf, MtM_buf, beta, precond_buf)) {
+                return error;
+            }
+
+            precond = [&](Buffer<float>& r, Buffer<float>& z) {
+                return CG_diag_precond(r, precond_buf, z);
+            };
+        } else if (preconditioner == "circulant") {
+            const auto spectrum_plan = CG_conv_circulant_plans.find(width, height);
+            const auto precond_plan = CG_circulant_precond_plans.find(width, height);
+            if (spectrum_plan == nullptr || precond_plan == nullptr) {
+                throw std::invalid_argument(FftPlans::notFound(width, height));
+            }
+
+            // The spectra are Hermitian symmetric, see fft2d_r2c.
+            precond_buf = Buffer<float>(width, (height + 1) / 2 + 1, channels);
+            void* spectrum_args[] = {K_buf.raw_buffer(), MtM_buf.raw_buffer(), &beta,
+                                     precond_buf.raw_buffer()};
+            if (const int error = spectrum_plan(spectrum_args)) {
+                return error;
+            }
+
+            precond = [&, precond_plan](Buffer<float>& r, Buffer<float>& z) {
+                void* args[] = {r.raw_buffer(), precond_buf.raw_buffer(), z.raw_buffer()};
+                return precond_plan(args);
+            };
+        } else if (preconditioner != "none") {
+            throw std::invalid_argument("Unknown preconditioner " + preconditioner +
+                                        ", expected 'none', 'jacobi' or 'circulant'");
+        }
+
+        // CG starts from the input.
+        Buffer<float> x_buf(width, height, channels);
+        x_buf.copy_from(input_buf);
+
+        const int success = prox_CG_conv_runtime.solve(
+            x_buf,
+            [&](Buffer<float>& r, Buffer<float, 0>& norm_r) {
+                return CG_conv_init(input_buf, Atb_buf, K_buf, MtM_buf, beta, r, norm_r);
+            },
+            precond,
+            [&](Buffer<float>& x, Buffer<float>& r, Buffer<float>& z, Buffer<float>& p,
+                float rho_prev, Buffer<float>& x_next, Buffer<float>& r_next,
+                Buffer<float>& p_next, Buffer<float, 0>& rho, Buffer<float, 0>& norm_r) {
+                return CG_conv_step(x, r, z, p, K_buf, MtM_buf, beta, rho_prev, x_next, r_next,
+                                    p_next, rho, norm_r);
+            },
+            max_iters, tol);
+
+        output_buf.copy_from(x_buf);
+        return success;
+    }
+
+} // proximal
+
+PYBIND11_MODULE(prox_CG_conv, m) {
+    m.def("run", &proximal::prox_CG_conv_glue,
+          "Proximal operator of convolution + mask, by (preconditioned) conjugate gradient. "
+          "The preconditioner is 'none', 'jacobi' (diagonal of A^T A), or 'circulant' (FFT "
+          "of the kernel, for the image sizes of the precompiled FFT plans)",
+          py::arg("input"), py::arg("Atb"), py::arg("K"), py::arg("MtM"), py::arg("beta"),
+          py::arg("output"), py::arg("max_iters") = 10, py::arg("tol") = 1e-4f,
+          py::arg("preconditioner") = "none");
+    m.attr("sizes") = proximal::CG_conv_circulant_plans.sizes();
+    proximal::prox_CG_conv_runtime.bind(m);
+}
\ No newline at end of file
@@ -0,0 +1,57 @@
+#include <pybind11/pybind11.h>
+
+#include "util.hpp"
+#include "cg_runtime.hpp"
+#include "CG_warp_init.h"
+#include "CG_warp_step.h"
+
+namespace proximal {
+
+CgRuntime prox_CG_warp_runtime;
+
+int prox_CG_warp_glue(const array_float_t input, const array_float_t Atb,
+    const array_float_t H, const array_float_t Hinv, const array_float_t MtM, float beta,
+    array_float_t output, int max_iters, float tol) {
+
+        using Halide::Runtime::Buffer;
+
+        auto input_buf = getHalideBuffer<3>(input);
+        auto Atb_buf = getHalideBuffer<3>(Atb);
+        auto H_buf = getHalideBuffer<3>(H);
+        auto Hinv_buf = getHalideBuffer<3>(Hinv);
+        auto MtM_buf = getHalideBuffer<3>(MtM);
+        auto output_buf = getHalideBuffer<3>(output, false);
+
+        // CG starts from the input.
+        Buffer<float> x_buf(input_buf.dim(0).extent(), input_buf.dim(1).extent(),
+                        input_buf.dim(2).extent());
+        x_buf.copy_from(input_buf);
+
+        const int success = prox_CG_warp_runtime.solve(
+            x_buf,
+            [&](Buffer<float>& r, Buffer<float, 0>& norm_r) {
+                return CG_warp_init(input_buf, Atb_buf, H_buf, Hinv_buf, MtM_buf, beta, r, norm_r);
+            },
+            // No preconditioner
+            CgRuntime::precond_t{},
+            [&](Buffer<float>& x, Buffer<float>& r, Buffer<float>& z, Buffer<float>& p,
+                float rho_prev, Buffer<float>& x_next, Buffer<float>& r_next,
+                Buffer<float>& p_next, Buffer<float, 0>& rho, Buffer<float, 0>& norm_r) {
+                return CG_warp_step(x, r, z, p, H_buf, Hinv_buf, MtM_buf, beta, rho_prev, x_next, r_next,
+                                    p_next, rho, norm_r);
+            },
+            max_iters, tol);
+
+        output_buf.copy_from(x_buf);
+        return success;
+    }
+
+} // proximal
+
+PYBIND11_MODULE(prox_CG_warp, m) {
+    m.def("run", &proximal::prox_CG_warp_glue,
+          "Proximal operator of warp + mask, by conjugate gradient",
+          py::arg("input"), py::arg("Atb"), py::arg("H"), py::arg("Hinv"), py::arg("MtM"), py::arg("beta"),
+          py::arg("output"), py::arg("max_iters") = 10, py::arg("tol") = 1e-4f);
+    proximal::prox_CG_warp_runtime.bind(m);
+}
\ No newline at end of file
@@ -1,29 +1,70 @@
-#include "least_square_direct.h"
+#include <pybind11/stl.h>
+
+#include <optional>
+#include <stdexcept>
+
+#include "fft_plan.hpp"
+#include "frequency_cache.hpp"
 #include "util.hpp"
 
+#define X(W, H) FFT_PLAN_DECLARE(least_square_direct, W, H)
+CONFIG_FFT_PLANS(X)
+#undef X
+
 namespace proximal {
 
+const FftPlans prox_L2_plans{
+#define X(W, H) FFT_PLAN_ENTRY(least_square_direct, W, H)
+    CONFIG_FFT_PLANS(X)
+#undef X
+};
+
+/** Fourier-transformed inputs, up to 256MB. */
+FrequencyCache prox_L2_cache{size_t(256) << 20};
+
 int
-prox_L2_glue(const array_float_t input, const float theta, const array_float_t offset,
-             const array_cxfloat_t freq_diag, const array_float_t output) {
+prox_L2_glue(const array_float_t input, float theta, const array_float_t offset,
+             const array_cxfloat_t freq_diag, const array_float_t output,
+             std::optional<uint64_t> handle) {
     auto input_buf = getHalideBuffer<3>(input);
     auto offset_buf = getHalideBuffer<3>(offset);
     auto freq_diag_buf = getHalideComplexBuffer<4>(freq_diag);
     auto output_buf = getHalideBuffer<3>(output, false);
 
-    // A hash to denote when the Fourier transformed offset signal should be
-    // recomputed. TODO(Antony): It is more practical to marshal the
-    // proximal.Problem instance hash from Python runtime to here.
-    const auto input_buf_hash = reinterpret_cast<uintptr_t>(input_buf.begin());
+    // Select the plan by the output image size.
+    const int width = output_buf.dim(0).extent();
+    const int height = output_buf.dim(1).extent();
 
-    const auto has_error = least_square_direct(input_buf, theta, offset_buf, freq_diag_buf,
-                                               input_buf_hash, output_buf);
+    const auto plan = prox_L2_plans.find(width, height);
+    if (plan == nullptr) {
+        throw std::invalid_argument(FftPlans::notFound(width, height));
+    }
+
+    // Look up the Fourier-transformed input by the problem handle, if
+    // provided by the caller; otherwise, by the content hash.
+    const auto key = FrequencyCache::makeKey(input_buf, handle, width, height);
+    auto [spectrum, is_cached] = prox_L2_cache.acquire(key);
+    auto exported = FrequencyCache::exportBuffer(spectrum, is_cached);
+
+    void* args[] = {input_buf.raw_buffer(),  &theta,
+                    offset_buf.raw_buffer(), freq_diag_buf.raw_buffer(),
+                    spectrum.raw_buffer(),   &is_cached,
+                    output_buf.raw_buffer(), exported.raw_buffer()};
+    const auto has_error = plan(args);
     output_buf.copy_to_host();
+
+    if (has_error == 0 && !is_cached) {
+        prox_L2_cache.insert(key, spectrum);
+    }
     return has_error;
 }
 
 }  // namespace proximal
 
 PYBIND11_MODULE(prox_L2, m) {
-    m.def("run", &proximal::prox_L2_glue, "Least square algorithm with direct FFT method");
-}
\ No newline at end of file
+    m.def("run", &proximal::prox_L2_glue, "Least square algorithm with direct FFT method",
+          py::arg("input"), py::arg("theta"), py::arg("offset"), py::arg("freq_diag"),
+          py::arg("output"), py::arg("handle") = py::none());
+    m.attr("sizes") = proximal::prox_L2_plans.sizes();
+    proximal::prox_L2_cache.bind(m);
+}
@@ -1,28 +1,72 @@
-#include "least_square_direct_ignore_offset.h"
+#include <pybind11/stl.h>
+
+#include <optional>
+#include <stdexcept>
+
+#include "fft_plan.hpp"
+#include "frequency_cache.hpp"
 #include "util.hpp"
 
+#define X(W, H) FFT_PLAN_DECLARE(least_square_direct_ignore_offset, W, H)
+CONFIG_FFT_PLANS(X)
+#undef X
+
 namespace proximal {
 
+const FftPlans prox_L2_ignore_offset_plans{
+#define X(W, H) FFT_PLAN_ENTRY(least_square_direct_ignore_offset, W, H)
+    CONFIG_FFT_PLANS(X)
+#undef X
+};
+
+/** Fourier-transformed inputs, up to 256MB. */
+FrequencyCache prox_L2_ignore_offset_cache{size_t(256) << 20};
+
 int
 prox_L2_ignore_offset_glue(const array_float_t input, 
-             const array_cxfloat_t freq_diag, const array_float_t output) {
+             const array_cxfloat_t freq_diag, const array_float_t output,
+             std::optional<uint64_t> handle) {
     auto input_buf = getHalideBuffer<3>(input);
     auto freq_diag_buf = getHalideComplexBuffer<4>(freq_diag);
     auto output_buf = getHalideBuffer<3>(output, true);
 
-    constexpr float dont_care = 0;
+    // Select the plan by the output image size.
+    const int width = output_buf.dim(0).extent();
+    const int height = output_buf.dim(1).extent();
+
+    const auto plan = prox_L2_ignore_offset_plans.find(width, height);
+    if (plan == nullptr) {
+        throw std::invalid_argument(FftPlans::notFound(width, height));
+    }
+
+    float dont_care = 0;
     auto& dont_care_buf = input_buf;
 
-    const uint64_t dont_care_hash = 0;
+    // Look up the Fourier-transformed input by the problem handle, if
+    // provided by the caller; otherwise, by the content hash.
+    const auto key = FrequencyCache::makeKey(input_buf, handle, width, height);
+    auto [spectrum, is_cached] = prox_L2_ignore_offset_cache.acquire(key);
+    auto exported = FrequencyCache::exportBuffer(spectrum, is_cached);
 
-    const auto success = least_square_direct_ignore_offset(
-        input_buf, dont_care, dont_care_buf, freq_diag_buf, dont_care_hash, output_buf);
+    void* args[] = {input_buf.raw_buffer(),     &dont_care,
+                    dont_care_buf.raw_buffer(), freq_diag_buf.raw_buffer(),
+                    spectrum.raw_buffer(),      &is_cached,
+                    output_buf.raw_buffer(),    exported.raw_buffer()};
+    const auto success = plan(args);
     output_buf.copy_to_host();
+
+    if (success == 0 && !is_cached) {
+        prox_L2_ignore_offset_cache.insert(key, spectrum);
+    }
     return success;
 }
 
 }  // namespace proximal
 
 PYBIND11_MODULE(prox_L2_ignore_offset, m) {
-    m.def("run", &proximal::prox_L2_ignore_offset_glue, "Least square algorithm with direct FFT method");
-}
\ No newline at end of file
+    m.def("run", &proximal::prox_L2_ignore_offset_glue,
+          "Least square algorithm with direct FFT method", py::arg("input"),
+          py::arg("freq_diag"), py::arg("output"), py::arg("handle") = py::none());
+    m.attr("sizes") = proximal::prox_L2_ignore_offset_plans.sizes();
+    proximal::prox_L2_ignore_offset_cache.bind(m);
+}
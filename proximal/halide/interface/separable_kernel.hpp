@@ -0,0 +1,115 @@
+#pragma once
+
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "HalideBuffer.h"
+
+namespace py = pybind11;
+
+namespace {
+
+/** Convolution kernel in the sum of separable form, i.e.
+ *
+ *   K(i, j, c) = sum_r Kx(i, r, c) * Ky(j, r, c) ,
+ *
+ * as the inputs of the pipeline convImgSep.
+ */
+struct SeparableKernel {
+    Halide::Runtime::Buffer<float> Kx;  //!< filter_width x rank x channels
+    Halide::Runtime::Buffer<float> Ky;  //!< filter_height x rank x channels
+
+    int rank() const { return Kx.dim(1).extent(); }
+};
+
+/** Decompose the kernel K by the singular value decomposition of each channel.
+ *
+ * Keep the fewest singular values, such that the approximation error is
+ * within the relative tolerance in the Frobenius norm. A tolerance of the
+ * order of the float precision detects the exact rank, e.g. 1 for Gaussian,
+ * box and axis-aligned motion blur. The rank is the maximum over the channels,
+ * padded by zeros.
+ *
+ * With adjoint=true, decompose the flipped kernel K(fw - 1 - i, fh - 1 - j, c),
+ * i.e. the kernel of At_conv.
+ */
+inline SeparableKernel
+decomposeKernel(const Halide::Runtime::Buffer<float>& K, const double tolerance,
+                const bool adjoint = false) {
+    const int width_kernel = K.dim(0).extent();
+    const int height_kernel = K.dim(1).extent();
+    const int channels = K.dim(2).extent();
+
+    const auto svd = py::module::import("numpy.linalg").attr("svd");
+
+    struct Factors {
+        py::array_t<double> U;
+        py::array_t<double> S;
+        py::array_t<double> Vt;
+        int rank;
+    };
+    std::vector<Factors> factors;
+
+    int rank = 1;
+    for (int c = 0; c < channels; c++) {
+        // Row major, i.e. M(j, i) = K(i, j, c) .
+        py::array_t<double> M({height_kernel, width_kernel});
+        auto m = M.mutable_unchecked<2>();
+        for (int j = 0; j < height_kernel; j++) {
+            for (int i = 0; i < width_kernel; i++) {
+                m(j, i) = adjoint ? K(width_kernel - 1 - i, height_kernel - 1 - j, c) : K(i, j, c);
+            }
+        }
+
+        const auto usv = svd(M).cast<py::tuple>();
+        Factors f{usv[0].cast<py::array_t<double>>(), usv[1].cast<py::array_t<double>>(),
+                  usv[2].cast<py::array_t<double>>(), 0};
+
+        // Singular values in descending order. The squared error of the rank R
+        // approximation is the sum of the remaining squared singular values.
+        const auto s = f.S.unchecked<1>();
+        double total = 0.0;
+        for (py::ssize_t k = 0; k < s.shape(0); k++) {
+            total += s(k) * s(k);
+        }
+
+        double residual = total;
+        while (f.rank < s.shape(0) && residual > tolerance * tolerance * total) {
+            residual -= s(f.rank) * s(f.rank);
+            f.rank++;
+        }
+
+        rank = std::max(rank, f.rank);
+        factors.push_back(std::move(f));
+    }
+
+    SeparableKernel sep{Halide::Runtime::Buffer<float>(width_kernel, rank, channels),
+                        Halide::Runtime::Buffer<float>(height_kernel, rank, channels)};
+    sep.Kx.fill(0.0f);
+    sep.Ky.fill(0.0f);
+
+    for (int c = 0; c < channels; c++) {
+        const auto U = factors[c].U.unchecked<2>();
+        const auto S = factors[c].S.unchecked<1>();
+        const auto Vt = factors[c].Vt.unchecked<2>();
+
+        // Split the singular value evenly between the two factors.
+        for (int r = 0; r < factors[c].rank; r++) {
+            const double scale = std::sqrt(S(r));
+            for (int i = 0; i < width_kernel; i++) {
+                sep.Kx(i, r, c) = float(scale * Vt(r, i));
+            }
+            for (int j = 0; j < height_kernel; j++) {
+                sep.Ky(j, r, c) = float(scale * U(j, r));
+            }
+        }
+    }
+
+    return sep;
+}
+
+}  // namespace
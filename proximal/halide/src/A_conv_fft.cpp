@@ -0,0 +1,181 @@
+////////////////////////////////////////////////////////////////////////////////
+// Convolution via FFT, as part of image formation.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <Halide.h>
+using namespace Halide;
+using namespace Halide::BoundaryConditions;
+
+#include "fft/fft.h"
+
+namespace {
+
+Var x("x"), y("y"), c("c"), u("u"), v("v"), tx("tx"), ty("ty");
+
+/** Same as convImg, i.e. A_conv with the circular boundary condition, but
+ * computed in the frequency domain. With adjoint=true, same as convImgT.
+ *
+ * The image of any size is split into tiles of tile_size x tile_size pixels,
+ * overlapping by the kernel support (overlap-save). Each tile is transformed
+ * independently, so that the tile and its spectrum stay in the cache, and
+ * the tiles are processed in parallel.
+ */
+class conv_fft_gen : public Generator<conv_fft_gen> {
+   public:
+    Input<Buffer<float, 3>> input{"input"};
+    Input<Buffer<float, 3>> K{"K"};
+    Output<Buffer<float, 3>> conv_output{"output"};
+
+    /** FFT size of the tiles. */
+    GeneratorParam<int> tile_size{"tile_size", 256, 16, 4096};
+
+    /** Largest kernel width and height supported by the tiles. Each tile
+     * produces tile_size - max_kernel_size + 1 output pixels per dimension. */
+    GeneratorParam<int> max_kernel_size{"max_kernel_size", 32, 1, 1024};
+
+    /** Convolve with the flipped kernel, i.e. At_conv. */
+    GeneratorParam<bool> adjoint{"adjoint", false};
+
+    /** Transform the whole image of size wtarget x htarget in one FFT,
+     * instead of the tiles. For benchmarking. */
+    GeneratorParam<bool> monolithic{"monolithic", false};
+    GeneratorParam<int> wtarget{"wtarget", 512, 2, 8192};
+    GeneratorParam<int> htarget{"htarget", 512, 2, 8192};
+
+    void generate() {
+        const Expr width = input.width();
+        const Expr height = input.height();
+        const Expr width_kernel = K.width();
+        const Expr height_kernel = K.height();
+
+        img_bounded = repeat_image(input, {{0, width}, {0, height}});
+
+        Func kernel_bounded = constant_exterior(K, 0.0f, {{0, width_kernel}, {0, height_kernel}});
+        if (adjoint) {
+            padded_kernel(u, v, c) = kernel_bounded(width_kernel - 1 - u, height_kernel - 1 - v, c);
+        } else {
+            padded_kernel(u, v, c) = kernel_bounded(u, v, c);
+        }
+
+        Func conv;
+        if (monolithic) {
+            conv = monolithicConv(width_kernel, height_kernel);
+        } else {
+            conv = tiledConv(width_kernel, height_kernel);
+        }
+
+        conv_output(x, y, c) =
+            require(width_kernel <= max_kernel_size && height_kernel <= max_kernel_size,
+                    conv(x, y, c), "Kernel size exceeds max_kernel_size");
+    }
+
+    void schedule() {
+        assert(!using_autoscheduler() && "Auto-scheduler not possible with manual schedules in FFT");
+
+        const auto vec_width = natural_vector_size<float>();
+
+        f_kernel.compute_root();
+
+        if (monolithic) {
+            input.dim(0).set_bounds(0, wtarget);
+            input.dim(1).set_bounds(0, htarget);
+
+            // Parallelized across the channels, or within each transform, see
+            // fft2d_r2c_batch.
+            f_input.compute_root();
+            inversed.compute_root();
+
+            conv_output.vectorize(x, vec_width).parallel(y);
+            return;
+        }
+
+        // Compute one tile of the output at a time. Each row of tiles is
+        // processed in parallel.
+        const int S = tile_size - max_kernel_size + 1;
+        Var xo{"xo"}, yo{"yo"}, xi{"xi"}, yi{"yi"};
+        conv_output.tile(x, y, xo, yo, xi, yi, S, S, TailStrategy::GuardWithIf)
+            .vectorize(xi, vec_width)
+            .parallel(yo);
+
+        f_input.compute_at(conv_output, xo);
+        inversed.compute_at(conv_output, xo);
+    }
+
+   private:
+    /** Overlap-save convolution of the tiles.
+     *
+     * The T x T tile (tx, ty) is the input image from (tx * S, ty * S), minus
+     * the halo of the kernel on the left and top. The circular convolution of
+     * the tile with the zero-padded kernel is exact for the last S pixels in
+     * each dimension, where S = T - max_kernel_size + 1 .
+     */
+    Func tiledConv(const Expr& width_kernel, const Expr& height_kernel) {
+        const int T = tile_size;
+        const int S = T - max_kernel_size + 1;
+        user_assert(S > 0) << "tile_size must be larger than max_kernel_size.";
+
+        const Expr halo_x = width_kernel - 1 - width_kernel / 2;
+        const Expr halo_y = height_kernel - 1 - height_kernel / 2;
+
+        Func tile{"tile"};
+        tile(u, v, tx, ty, c) = img_bounded(tx * S + u - halo_x, ty * S + v - halo_y, c);
+
+        Fft2dDesc fwd_desc{};
+        fwd_desc.name = "tile";
+        f_input = fft2d_r2c(tile, T, T, target, fwd_desc);
+
+        Fft2dDesc kernel_desc{};
+        kernel_desc.name = "kernel";
+        f_kernel = fft2d_r2c(padded_kernel, T, T, target, kernel_desc);
+
+        ComplexFunc product{"product"};
+        product(u, v, tx, ty, c) = f_input(u, v, tx, ty, c) * f_kernel(u, v, c);
+
+        Fft2dDesc inv_desc{};
+        inv_desc.gain = 1.0f / (T * T);
+        inversed = fft2d_c2r(product, T, T, target, inv_desc);
+
+        Func conv{"conv"};
+        conv(x, y, c) =
+            inversed(x % S + width_kernel - 1, y % S + height_kernel - 1, x / S, y / S, c);
+        return conv;
+    }
+
+    /** Circular convolution of the whole image. The kernel is shifted, such
+     * that the kernel anchor K(width_kernel / 2, height_kernel / 2) is at the
+     * origin. */
+    Func monolithicConv(const Expr& width_kernel, const Expr& height_kernel) {
+        const int W = wtarget;
+        const int H = htarget;
+        const Expr n_channels = input.dim(2).extent();
+
+        Func image{"image"};
+        image(u, v, c) = img_bounded(u, v, c);
+
+        Func shifted_kernel{"shifted_kernel"};
+        shifted_kernel(u, v, c) =
+            padded_kernel((u + width_kernel / 2) % W, (v + height_kernel / 2) % H, c);
+
+        f_input = fft2d_r2c_batch(image, W, H, n_channels, target);
+        f_kernel = fft2d_r2c(shifted_kernel, W, H, target);
+
+        ComplexFunc product{"product"};
+        product(u, v, c) = f_input(u, v, c) * f_kernel(u, v, c);
+
+        Fft2dDesc inv_desc{};
+        inv_desc.gain = 1.0f / (W * H);
+        inversed = fft2d_c2r_batch(product, W, H, n_channels, target, inv_desc);
+        return inversed;
+    }
+
+    Func img_bounded{"img_bounded"};
+    Func padded_kernel{"padded_kernel"};
+
+    ComplexFunc f_input;
+    ComplexFunc f_kernel;
+    Func inversed;
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(conv_fft_gen, convImgFFT);
@@ -0,0 +1,78 @@
+////////////////////////////////////////////////////////////////////////////////
+// Convolution with a separable, or low-rank, kernel as part of image formation.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <Halide.h>
+using namespace Halide;
+using namespace Halide::BoundaryConditions;
+
+namespace {
+
+Var x("x"), y("y"), c("c"), r("r");
+
+/** Same as convImg, i.e. A_conv with the circular boundary condition, for the
+ * kernel of rank R in the sum of separable form:
+ *
+ *   K(i, j, c) = sum_r Kx(i, r, c) * Ky(j, r, c) .
+ *
+ * The horizontal pass convolves each row with Kx(., r, c), then the vertical
+ * pass convolves each column with Ky(., r, c) and sums over the rank. The
+ * cost is R * (filter_width + filter_height) per pixel, instead of
+ * filter_width * filter_height.
+ *
+ * For At_conv, reverse Kx and Ky along the first dimension.
+ */
+class conv_sep_gen : public Generator<conv_sep_gen> {
+   public:
+    Input<Buffer<float, 3>> input{"input"};
+
+    /** Horizontal factors, of size filter_width x rank x channels. */
+    Input<Buffer<float, 3>> Kx{"Kx"};
+
+    /** Vertical factors, of size filter_height x rank x channels. */
+    Input<Buffer<float, 3>> Ky{"Ky"};
+
+    Output<Buffer<float, 3>> conv_output{"output"};
+
+    void generate() {
+        const Expr width = input.width();
+        const Expr height = input.height();
+        const Expr width_kernel = Kx.dim(0).extent();
+        const Expr height_kernel = Ky.dim(0).extent();
+        const Expr rank = Kx.dim(1).extent();
+
+        Func img_bounded = repeat_image(input, {{0, width}, {0, height}});
+
+        RDom rx(0, width_kernel);
+        horizontal(x, y, r, c) = sum(img_bounded(x - rx + width_kernel / 2, y, c) * Kx(rx, r, c));
+
+        RDom ry(0, height_kernel, 0, rank);
+        conv_output(x, y, c) =
+            sum(horizontal(x, y - ry.x + height_kernel / 2, ry.y, c) * Ky(ry.x, ry.y, c));
+    }
+
+    void schedule() {
+        assert(!using_autoscheduler() && "Auto-scheduler not required for the separable pipeline");
+
+        Ky.dim(1).set_extent(Kx.dim(1).extent());
+        Ky.dim(2).set_extent(Kx.dim(2).extent());
+
+        const auto vec_width = natural_vector_size<float>();
+
+        // Compute one tile of the output at a time, such that the horizontal
+        // pass of the tile, plus the kernel support, stays in the cache.
+        Var xo{"xo"}, yo{"yo"}, xi{"xi"}, yi{"yi"};
+        conv_output.tile(x, y, xo, yo, xi, yi, 256, 32, TailStrategy::GuardWithIf)
+            .vectorize(xi, vec_width)
+            .parallel(yo);
+
+        horizontal.compute_at(conv_output, xo).vectorize(x, vec_width);
+    }
+
+   private:
+    Func horizontal{"horizontal"};
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(conv_sep_gen, convImgSep);
@@ -0,0 +1,77 @@
+////////////////////////////////////////////////////////////////////////////////
+// Spatially varying convolution as part of image formation.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <Halide.h>
+using namespace Halide;
+using namespace Halide::BoundaryConditions;
+
+namespace {
+
+Var x("x"), y("y"), c("c"), k("k");
+
+/** Convolution with a field-dependent PSF, blended from a grid of n_psf
+ * kernels (Nagy & O'Leary, 1998):
+ *
+ *   A = sum_k K_k * diag(W_k) ,
+ *
+ * where K(., ., k) is the PSF measured at the grid point k, and W(x, y, k) its
+ * interpolation weight at the pixel (x, y), e.g. bilinear between the grid
+ * points. The weights of each pixel should sum up to one.
+ *
+ * All kernels are evaluated in the same pass over the output tiles, instead of
+ * one pass of convImg per kernel.
+ */
+class conv_sv_gen : public Generator<conv_sv_gen> {
+   public:
+    Input<Buffer<float, 3>> input{"input"};
+    Input<Buffer<float, 3>> K{"K"};
+    Input<Buffer<float, 3>> W{"W"};
+    Output<Buffer<float, 3>> conv_output{"output"};
+
+    void generate() {
+        const Expr width = input.width();
+        const Expr height = input.height();
+
+        const Expr width_kernel = K.width();
+        const Expr height_kernel = K.height();
+        const Expr n_psf = K.channels();
+
+        Func img_bounded = repeat_image(input, {{0, width}, {0, height}});
+        Func weights_bounded = repeat_image(W, {{0, width}, {0, height}});
+
+        // Weighted image of each kernel
+        weighted(x, y, c, k) = img_bounded(x, y, c) * weights_bounded(x, y, k);
+
+        // Convolution, summed over the kernels
+        RDom rf(0, width_kernel, 0, height_kernel, 0, n_psf);
+        conv_output(x, y, c) =
+            sum(weighted(x - rf.x + width_kernel / 2, y - rf.y + height_kernel / 2, c, rf.z) *
+                K(rf.x, rf.y, rf.z));
+    }
+
+    void schedule() {
+        W.dim(0).set_extent(input.dim(0).extent());
+        W.dim(1).set_extent(input.dim(1).extent());
+        W.dim(2).set_extent(K.dim(2).extent());
+
+        const auto vec_width = natural_vector_size<float>();
+
+        // Compute one tile of the output at a time. The weighted images of
+        // the tile, plus the kernel support, stay in the cache for all the
+        // kernels.
+        Var xo{"xo"}, yo{"yo"}, xi{"xi"}, yi{"yi"};
+        conv_output.tile(x, y, xo, yo, xi, yi, 64, 32, TailStrategy::GuardWithIf)
+            .vectorize(xi, vec_width)
+            .parallel(yo);
+
+        weighted.compute_at(conv_output, xo).vectorize(x, vec_width);
+    }
+
+   private:
+    Func weighted{"weighted"};
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(conv_sv_gen, convImgSV);
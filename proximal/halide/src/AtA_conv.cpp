@@ -0,0 +1,38 @@
+////////////////////////////////////////////////////////////////////////////////
+//Convolution, mask and adjoint convolution, fused, as part of image formation.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <Halide.h>
+using namespace Halide;
+using namespace Halide::BoundaryConditions;
+
+#include "core/image_formation.h"
+
+class conv_normal_gen : public Generator<conv_normal_gen> {
+public:
+
+    Input<Buffer<float, 3>> input{"input"};
+    Input<Buffer<float, 3>> K{"K"};
+    Input<Buffer<float, 3>> MtM{"MtM"};
+    Output<Buffer<float, 3>> conv_normal_output{"output"};
+
+    void generate() {
+        Expr width = input.width();
+        Expr height = input.height();
+
+        Expr width_kernel = K.width();
+        Expr height_kernel = K.height();
+
+        // Scheduled in AtA_conv.
+        conv_normal_output = AtA_conv(input, width, height, K, width_kernel, height_kernel, MtM);
+    }
+
+    void schedule() {
+        assert(!using_autoscheduler() && "Auto-scheduler not required for the fused AtA_conv");
+
+        MtM.dim(0).set_extent(input.dim(0).extent());
+        MtM.dim(1).set_extent(input.dim(1).extent());
+    }
+};
+
+HALIDE_REGISTER_GENERATOR(conv_normal_gen, convImgAtA);
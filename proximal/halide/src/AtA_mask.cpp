@@ -0,0 +1,41 @@
+////////////////////////////////////////////////////////////////////////////////
+// Weighting by M^T M (diagonal weighting matrix M) as part of image formation.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <Halide.h>
+using namespace Halide;
+using namespace Halide::BoundaryConditions;
+
+#include "core/image_formation.h"
+
+class mask_normal_gen : public Generator<mask_normal_gen> {
+   public:
+    Input<Buffer<float, 3>> input{"input"};
+    Input<Buffer<float, 3>> mask{"mask"};
+    Output<Buffer<float, 3>> output{"output"};
+
+    void generate() {
+        // Image dimensions
+        Expr width = input.width();
+        Expr height = input.height();
+
+        output(x, y, c) = AtA_M(input, width, height, mask)(x, y, c);
+    }
+
+    void schedule() {
+        if (using_autoscheduler()) {
+            input.set_estimates({{0, 512}, {0, 512}, {0, 1}});
+            mask.set_estimates({{0, 512}, {0, 512}, {0, 1}});
+            output.set_estimates({{0, 512}, {0, 512}, {0, 1}});
+            return;
+        }
+
+        const auto vec_width = natural_vector_size<float>();
+
+        output.reorder(c, y, x);
+        output.vectorize(y, vec_width);
+        output.parallel(x);
+    }
+};
+
+HALIDE_REGISTER_GENERATOR(mask_normal_gen, WImgAtA);
@@ -0,0 +1,49 @@
+////////////////////////////////////////////////////////////////////////////////
+// Warp with n homographies, mask and adjoint warp, fused, as part of image
+// formation. The different homographies are ordered in stack of matrices.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <Halide.h>
+using namespace Halide;
+using namespace Halide::BoundaryConditions;
+
+#include "core/image_formation.h"
+
+class warp_normal_gen : public Generator<warp_normal_gen> {
+    Var xo, xi;
+
+   public:
+    Input<Buffer<float, 3>> input{"input"};
+    Input<Buffer<float, 3>> H{"H"};
+    Input<Buffer<float, 3>> Hinv{"Hinv"};
+    Input<Buffer<float, 3>> MtM{"MtM"};
+    Output<Buffer<float, 3>> output{"output"};
+
+    void generate() {
+        Expr width = input.width();
+        Expr height = input.height();
+        Expr nhom = H.channels();
+
+        // Swap x-y axes, same as in warpImg and warpImgT.
+        Func input_swap_axes;
+        input_swap_axes(y, x, c) = input(x, y, c);
+
+        Func mask_swap_axes;
+        mask_swap_axes(y, x, c) = MtM(x, y, c);
+
+        // Again, swap axes back
+        output(y, x, c) = AtA_warpHomography(input_swap_axes, width, height, H, Hinv, nhom,
+                                             mask_swap_axes)(x, y, c);
+    }
+
+    void schedule() {
+        assert(!using_autoscheduler() && "Auto-scheduler not required for the fused AtA_warp");
+
+        const auto vec_width = natural_vector_size<float>();
+        output.vectorize(y, vec_width);
+
+        output.split(x, xo, x, 32).parallel(xo);
+    }
+};
+
+HALIDE_REGISTER_GENERATOR(warp_normal_gen, warpImgAtA);
@@ -0,0 +1,70 @@
+////////////////////////////////////////////////////////////////////////////////
+// Adjoint of the spatially varying convolution as part of image formation.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <Halide.h>
+using namespace Halide;
+using namespace Halide::BoundaryConditions;
+
+namespace {
+
+Var x("x"), y("y"), c("c"), k("k");
+
+/** Adjoint of convImgSV:
+ *
+ *   A^T = sum_k diag(W_k) * K_k^T ,
+ *
+ * i.e. convolve with each flipped kernel, then blend by the interpolation
+ * weights, in the same pass over the output tiles.
+ */
+class conv_sv_trans_gen : public Generator<conv_sv_trans_gen> {
+   public:
+    Input<Buffer<float, 3>> input{"input"};
+    Input<Buffer<float, 3>> K{"K"};
+    Input<Buffer<float, 3>> W{"W"};
+    Output<Buffer<float, 3>> conv_trans_output{"output"};
+
+    void generate() {
+        const Expr width = input.width();
+        const Expr height = input.height();
+
+        const Expr width_kernel = K.width();
+        const Expr height_kernel = K.height();
+        const Expr n_psf = K.channels();
+
+        Func img_bounded = repeat_image(input, {{0, width}, {0, height}});
+
+        // Convolution with each flipped kernel
+        RDom rf(0, width_kernel, 0, height_kernel);
+        conv_k(x, y, c, k) =
+            sum(img_bounded(x - rf.x + width_kernel / 2, y - rf.y + height_kernel / 2, c) *
+                K(width_kernel - 1 - rf.x, height_kernel - 1 - rf.y, k));
+
+        // Blend by the interpolation weights
+        RDom rk(0, n_psf);
+        conv_trans_output(x, y, c) = sum(W(x, y, rk) * conv_k(x, y, c, rk));
+    }
+
+    void schedule() {
+        W.dim(0).set_extent(input.dim(0).extent());
+        W.dim(1).set_extent(input.dim(1).extent());
+        W.dim(2).set_extent(K.dim(2).extent());
+
+        const auto vec_width = natural_vector_size<float>();
+
+        // Compute one tile of the output at a time, for all the kernels.
+        Var xo{"xo"}, yo{"yo"}, xi{"xi"}, yi{"yi"};
+        conv_trans_output.tile(x, y, xo, yo, xi, yi, 64, 32, TailStrategy::GuardWithIf)
+            .vectorize(xi, vec_width)
+            .parallel(yo);
+
+        conv_k.compute_at(conv_trans_output, xo).vectorize(x, vec_width);
+    }
+
+   private:
+    Func conv_k{"conv_k"};
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(conv_sv_trans_gen, convImgSVT);
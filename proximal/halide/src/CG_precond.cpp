@@ -0,0 +1,216 @@
+////////////////////////////////////////////////////////////////////////////////
+// Preconditioners of the conjugate gradient for the proximal operator of
+// convolution + mask, i.e. approximate inverses of
+//
+//   Mfun = beta * K^T M^T M K + I .
+//
+// The run time computes the preconditioner once per CG solve, then applies it
+// to the residual in every CG step.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <Halide.h>
+using namespace Halide;
+using namespace Halide::BoundaryConditions;
+
+#include "core/image_formation.h"
+#include "fft/fft.h"
+
+/** Inverse of the diagonal of Mfun (Jacobi preconditioner), i.e.
+ *
+ *   diag(K^T M^T M K)(x, y) = sum_{u, v} K(u, v)^2 MtM(x + u - fw / 2, y + v - fh / 2) ,
+ *
+ * the adjoint convolution of the mask with the squared kernel.
+ */
+class cg_conv_jacobi_gen : public Generator<cg_conv_jacobi_gen> {
+public:
+
+    Input<Buffer<float, 3>> K{"K"};
+    Input<Buffer<float, 3>> MtM{"MtM"};
+    Input<float> beta{"beta"};
+    Output<Buffer<float, 3>> inv_diag{"inv_diag"};
+
+    void generate() {
+        Expr width = MtM.width();
+        Expr height = MtM.height();
+
+        Expr width_kernel = K.width();
+        Expr height_kernel = K.height();
+
+        Func K_square("K_square");
+        K_square(x, y, c) = K(x, y, c) * K(x, y, c);
+
+        Func diag = At_conv(MtM, width, height, K_square, width_kernel, height_kernel);
+
+        inv_diag(x, y, c) = 1.0f / (1.0f + beta * diag(x, y, c));
+    }
+
+    void schedule() {
+        assert(!using_autoscheduler() && "Auto-scheduler not required for CG_conv_jacobi");
+
+        const auto vec_width = natural_vector_size<float>();
+
+        Var yo, yi;
+        inv_diag.split(y, yo, yi, 32, TailStrategy::GuardWithIf)
+            .vectorize(x, vec_width)
+            .parallel(yo);
+    }
+};
+
+/** Diagonal preconditioner z = w .* r, e.g. with w from CG_conv_jacobi. */
+class cg_diag_precond_gen : public Generator<cg_diag_precond_gen> {
+public:
+
+    Input<Buffer<float, 3>> r{"r"};
+    Input<Buffer<float, 3>> w{"w"};
+    Output<Buffer<float, 3>> z{"z"};
+
+    void generate() {
+        z(x, y, c) = w(x, y, c) * r(x, y, c);
+    }
+
+    void schedule() {
+        assert(!using_autoscheduler() && "Auto-scheduler not required for CG_diag_precond");
+
+        const auto vec_width = natural_vector_size<float>();
+
+        Var yo, yi;
+        z.split(y, yo, yi, 32, TailStrategy::GuardWithIf)
+            .vectorize(x, vec_width)
+            .parallel(yo);
+    }
+};
+
+/** Inverse eigenvalues of the circulant approximation of Mfun, with the mask
+ * replaced by its mean (Chan, 1988):
+ *
+ *   Mfun ~= F^H (beta * mean(MtM) |F k|^2 + 1) F ,
+ *
+ * where F k is the DFT of the kernel, centered at the origin with the circular
+ * boundary condition of A_conv. The spectrum is Hermitian symmetric, see
+ * fft2d_r2c.
+ */
+class cg_conv_circulant_gen : public Generator<cg_conv_circulant_gen> {
+public:
+
+    Input<Buffer<float, 3>> K{"K"};
+    Input<Buffer<float, 3>> MtM{"MtM"};
+    Input<float> beta{"beta"};
+    Output<Buffer<float, 3>> inv_spectrum{"inv_spectrum"};
+
+    GeneratorParam<int> wtarget{"wtarget", 512, 2, 4096};
+    GeneratorParam<int> htarget{"htarget", 512, 2, 4096};
+
+    void generate() {
+        const int W = wtarget;
+        const int H = htarget;
+
+        Expr width_kernel = K.width();
+        Expr height_kernel = K.height();
+        const Expr n_channels = MtM.channels();
+
+        // Mean of the mask, per channel
+        RDom rm(0, W, 0, H);
+        mask_mean(c) = sum(MtM(rm.x, rm.y, c)) / float(W * H);
+
+        // Kernel with its center at the origin: the tap (u, v) of the kernel
+        // shifts the image by (u - fw / 2, v - fh / 2), modulo the image size.
+        const Expr u = (x + width_kernel / 2) % W;
+        const Expr v = (y + height_kernel / 2) % H;
+        centered_kernel(x, y, c) = constant_exterior(K, 0.f, {{0, width_kernel}, {0, height_kernel}})(u, v, c);
+
+        f_kernel = fft2d_r2c_batch(centered_kernel, W, H, n_channels, target);
+
+        const Expr power = re(f_kernel(x, y, c)) * re(f_kernel(x, y, c)) +
+                           im(f_kernel(x, y, c)) * im(f_kernel(x, y, c));
+        inv_spectrum(x, y, c) = 1.0f / (1.0f + beta * mask_mean(c) * power);
+    }
+
+    void schedule() {
+        assert(!using_autoscheduler() && "Auto-scheduler not possible with manual schedules in FFT");
+
+        MtM.dim(0).set_bounds(0, wtarget);
+        MtM.dim(1).set_bounds(0, htarget);
+
+        inv_spectrum.dim(0).set_bounds(0, wtarget);
+        inv_spectrum.dim(1).set_bounds(0, (htarget + 1) / 2 + 1);
+        inv_spectrum.dim(2).set_extent(MtM.dim(2).extent());
+
+        const auto vfloat = natural_vector_size<float>();
+        inv_spectrum.vectorize(x, vfloat).parallel(y);
+
+        mask_mean.compute_root();
+        f_kernel.compute_root();
+        centered_kernel.compute_root().vectorize(x, vfloat).parallel(y);
+    }
+
+   private:
+    Func mask_mean{"mask_mean"};
+    Func centered_kernel{"centered_kernel"};
+    ComplexFunc f_kernel;
+};
+
+/** Circulant preconditioner z = F^H diag(inv_spectrum) F r, with
+ * inv_spectrum from CG_conv_circulant. */
+class cg_circulant_precond_gen : public Generator<cg_circulant_precond_gen> {
+public:
+
+    Input<Buffer<float, 3>> r{"r"};
+    Input<Buffer<float, 3>> inv_spectrum{"inv_spectrum"};
+    Output<Buffer<float, 3>> z{"z"};
+
+    GeneratorParam<int> wtarget{"wtarget", 512, 2, 4096};
+    GeneratorParam<int> htarget{"htarget", 512, 2, 4096};
+
+    void generate() {
+        const int W = wtarget;
+        const int H = htarget;
+
+        const Expr n_channels = r.channels();
+
+        // Forward DFT
+        f_r = fft2d_r2c_batch(r, W, H, n_channels, target);
+
+        filtered(x, y, c) = f_r(x, y, c) * inv_spectrum(x, y, c);
+
+        // Inverse DFT
+        Fft2dDesc inv_desc{};
+        inv_desc.gain = 1.0f / (W * H);
+
+        inversed = fft2d_c2r_batch(filtered, W, H, n_channels, target, inv_desc);
+        z = inversed;
+    }
+
+    void schedule() {
+        assert(!using_autoscheduler() && "Auto-scheduler not possible with manual schedules in FFT");
+
+        r.dim(0).set_bounds(0, wtarget);
+        r.dim(1).set_bounds(0, htarget);
+        z.dim(0).set_bounds(0, wtarget);
+        z.dim(1).set_bounds(0, htarget);
+        z.dim(2).set_extent(r.dim(2).extent());
+
+        inv_spectrum.dim(0).set_bounds(0, wtarget);
+        inv_spectrum.dim(1).set_bounds(0, (htarget + 1) / 2 + 1);
+        inv_spectrum.dim(2).set_extent(r.dim(2).extent());
+
+        const auto vfloat = natural_vector_size<float>();
+        z.vectorize(x, vfloat).parallel(y);
+
+        // Parallelized across the channels, or within each transform, see
+        // fft2d_c2r_batch.
+        inversed.compute_root();
+        f_r.compute_root();
+
+        filtered.compute_root().vectorize(x, vfloat).parallel(y);
+    }
+
+   private:
+    ComplexFunc f_r;
+    ComplexFunc filtered{"filtered"};
+    Func inversed{"inversed"};
+};
+
+HALIDE_REGISTER_GENERATOR(cg_conv_jacobi_gen, CG_conv_jacobi);
+HALIDE_REGISTER_GENERATOR(cg_diag_precond_gen, CG_diag_precond);
+HALIDE_REGISTER_GENERATOR(cg_conv_circulant_gen, CG_conv_circulant);
+HALIDE_REGISTER_GENERATOR(cg_circulant_precond_gen, CG_circulant_precond);
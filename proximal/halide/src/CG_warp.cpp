@@ -0,0 +1,129 @@
+////////////////////////////////////////////////////////////////////////////////
+// Conjugate gradient for the proximal operator of warp + mask, as part of
+// image formation. The run time calls CG_warp_init once, then CG_warp_step per
+// iteration until the residual is small enough. The different homographies are
+// ordered in stack of matrices.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <Halide.h>
+using namespace Halide;
+using namespace Halide::BoundaryConditions;
+
+#include "core/prox_operators_image_form.h"
+
+/** Initial residual r = b - Mfun(xin) of the linear system
+ *
+ *   (beta * A^T A + I) x = beta * A^T b + xin ,
+ *
+ * with A = M * W, and its L2 norm.
+ */
+class cg_warp_init_gen : public Generator<cg_warp_init_gen> {
+public:
+
+    Input<Buffer<float, 3>> input{"input"};
+    Input<Buffer<float, 3>> Atb{"Atb"};
+    Input<Buffer<float, 3>> H{"H"};
+    Input<Buffer<float, 3>> Hinv{"Hinv"};
+    Input<Buffer<float, 3>> MtM{"MtM"};
+    Input<float> beta{"beta"};
+
+    Output<Buffer<float, 3>> r_output{"r"};
+    Output<Buffer<float, 0>> norm_r_output{"norm_r"};
+
+    void generate() {
+        Expr width = input.width();
+        Expr height = input.height();
+        Expr ch = input.channels();
+
+        Expr nhom = H.channels();
+
+        // Swaps the x-y axes, same as in warpImgAtA.
+        auto Mfun = CG_warp_Mfun(H, Hinv, MtM, width, height, nhom, beta);
+
+        r_output = CG_residual(input, CG_warp_rhs(input, Atb, beta), Mfun);
+        norm_r_output() = norm_L2(r_output, width, height, ch)();
+    }
+
+    void schedule() {
+        assert(!using_autoscheduler() && "Auto-scheduler not required for CG_warp_init");
+
+        MtM.dim(0).set_extent(input.dim(0).extent());
+        MtM.dim(1).set_extent(input.dim(1).extent());
+        Atb.dim(0).set_extent(input.dim(0).extent());
+        Atb.dim(1).set_extent(input.dim(1).extent());
+
+        const auto vec_width = natural_vector_size<float>();
+
+        Var yo, yi;
+        r_output.split(y, yo, yi, 32, TailStrategy::GuardWithIf)
+            .vectorize(x, vec_width)
+            .parallel(yo);
+    }
+};
+
+/** One preconditioned CG step of the linear system of cg_warp_init_gen. The
+ * scalar rho_prev is the output rho of the previous step, or zero in the first
+ * step. z_in is the preconditioned residual, or r_in itself without
+ * preconditioner.
+ */
+class cg_warp_step_gen : public Generator<cg_warp_step_gen> {
+public:
+
+    Input<Buffer<float, 3>> x_input{"x_in"};
+    Input<Buffer<float, 3>> r_input{"r_in"};
+    Input<Buffer<float, 3>> z_input{"z_in"};
+    Input<Buffer<float, 3>> p_input{"p_in"};
+    Input<Buffer<float, 3>> H{"H"};
+    Input<Buffer<float, 3>> Hinv{"Hinv"};
+    Input<Buffer<float, 3>> MtM{"MtM"};
+    Input<float> beta{"beta"};
+    Input<float> rho_prev{"rho_prev"};
+
+    Output<Buffer<float, 3>> x_output{"x_next"};
+    Output<Buffer<float, 3>> r_output{"r_next"};
+    Output<Buffer<float, 3>> p_output{"p_next"};
+    Output<Buffer<float, 0>> rho_output{"rho"};
+    Output<Buffer<float, 0>> norm_r_output{"norm_r"};
+
+    void generate() {
+        Expr width = x_input.width();
+        Expr height = x_input.height();
+        Expr ch = x_input.channels();
+
+        Expr nhom = H.channels();
+
+        // Swaps the x-y axes, same as in warpImgAtA.
+        auto Mfun = CG_warp_Mfun(H, Hinv, MtM, width, height, nhom, beta);
+
+        // p and rho are scheduled in CG_step.
+        const CG_state state = CG_step(x_input, r_input, z_input, p_input, rho_prev, Mfun, width, height, ch);
+
+        x_output = state.x;
+        r_output = state.r;
+        p_output = state.p;
+        rho_output = state.rho;
+        norm_r_output = state.norm_r;
+    }
+
+    void schedule() {
+        assert(!using_autoscheduler() && "Auto-scheduler not required for CG_warp_step");
+
+        MtM.dim(0).set_extent(x_input.dim(0).extent());
+        MtM.dim(1).set_extent(x_input.dim(1).extent());
+        z_input.dim(0).set_extent(x_input.dim(0).extent());
+        z_input.dim(1).set_extent(x_input.dim(1).extent());
+
+        const auto vec_width = natural_vector_size<float>();
+
+        Var yo, yi;
+        x_output.split(y, yo, yi, 32, TailStrategy::GuardWithIf)
+            .vectorize(x, vec_width)
+            .parallel(yo);
+        r_output.split(y, yo, yi, 32, TailStrategy::GuardWithIf)
+            .vectorize(x, vec_width)
+            .parallel(yo);
+    }
+};
+
+HALIDE_REGISTER_GENERATOR(cg_warp_init_gen, CG_warp_init);
+HALIDE_REGISTER_GENERATOR(cg_warp_step_gen, CG_warp_step);
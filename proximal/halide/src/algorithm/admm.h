@@ -0,0 +1,86 @@
+#pragma once
+
+#include <utility>
+
+#include "Halide.h"
+
+// Back-porting of the <range> library from C++20 standard.
+// Provides zip_view
+#include "problem-interface.h"
+#include "range/v3/algorithm/transform.hpp"
+#include "range/v3/view/zip.hpp"
+#include "vars.h"
+
+using namespace Halide;
+using ranges::zip_view;
+
+namespace algorithm {
+namespace admm {
+
+/** One iteration of the (full) ADMM algorithm.
+ *
+ * Unlike the linearized ADMM, the v-update solves the least-squares problem
+ *
+ *     v_new = argmin_v omega(v) + 1 / (2 lmb) || K v - z + u ||^2
+ *
+ * exactly, with the solver least_squares(KTw, lmb), where KTw = K^T (z - u).
+ * The solver is typically the frequency domain inverse, when omega is a sum of
+ * squares and K^T K is diagonalized by the DFT.
+ *
+ * Returns the updated v, z_i, u_i, and also K v_new, so that the caller can
+ * re-use the forward product to compute the convergence metrics, e.g. with
+ * linearized_admm::computeConvergence().
+ */
+template <size_t N, LinOpGraph G, typename LeastSquares, Prox P2>
+std::tuple<Func, FuncTuple<N>, FuncTuple<N>, FuncTuple<N>>
+iterate(const FuncTuple<N>& z, const FuncTuple<N>& u, G& K, LeastSquares& least_squares,
+        std::array<P2, N> psi_fns, const Expr& lmb) {
+    using Vars = std::vector<Var>;
+
+    // Update v
+    Func v_new{"v_new"};
+    {
+        FuncTuple<N> zu;
+        ranges::transform(zip_view{z, u, psi_fns}, zu.begin(), [=](const auto& args) -> Func {
+            const auto& [_z, _u, prox] = args;
+            const auto vars = (prox.n_dim == 4) ? Vars{x, y, c, k} : Vars{x, y, c};
+
+            Func _zu{"zu"};
+            _zu(vars) = _z(vars) - _u(vars);
+
+            return _zu;
+        });
+
+        v_new = least_squares(K.adjoint(zu), lmb);
+    }
+
+    // Update z_i for i = 0..N .
+    const FuncTuple<N> Kv = K.forward(v_new);
+    FuncTuple<N> z_new;
+    ranges::transform(zip_view{Kv, u, psi_fns}, z_new.begin(), [=](const auto& args) -> Func {
+        const auto& [_Kv, _u, prox] = args;
+        const auto vars = (prox.n_dim == 4) ? Vars{x, y, c, k} : Vars{x, y, c};
+
+        Func Kv_u{"Kv_u"};
+        Kv_u(vars) = _Kv(vars) + _u(vars);
+
+        return prox(Kv_u, 1.0f / lmb);
+    });
+
+    // Update u.
+    FuncTuple<N> u_new;
+    ranges::transform(zip_view{u, Kv, z_new, psi_fns}, u_new.begin(), [=](const auto& args) -> Func {
+        const auto& [_u, _Kv, _z, prox] = args;
+        const auto vars = (prox.n_dim == 4) ? Vars{x, y, c, k} : Vars{x, y, c};
+
+        Func _u_new{"u_new"};
+        _u_new(vars) = _u(vars) + _Kv(vars) - _z(vars);
+
+        return _u_new;
+    });
+
+    return {v_new, z_new, u_new, Kv};
+}
+
+}  // namespace admm
+}  // namespace algorithm
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <utility>
+
+#include "Halide.h"
+
+// Back-porting of the <range> library from C++20 standard.
+// Provides zip_view
+#include "problem-interface.h"
+#include "range/v3/algorithm/transform.hpp"
+#include "range/v3/view/zip.hpp"
+#include "utils.h"
+#include "vars.h"
+
+using namespace Halide;
+using ranges::zip_view;
+
+namespace algorithm {
+namespace half_quadratic_splitting {
+
+/** One inner iteration of the half-quadratic splitting (HQS) algorithm.
+ *
+ * Minimize omega(x) + sum_i psi_i(w_i) + rho / 2 || K x - w ||^2, for a fixed
+ * penalty rho, by alternating the psi step
+ *
+ *     w_i = prox_{psi_i / rho}(K_i x)
+ *
+ * and the omega step, solved by least_squares(KTw, 1 / rho), where
+ * KTw = K^T w .
+ *
+ * The caller increases rho between the outer iterations. Returns the updated x
+ * and w_i.
+ */
+template <size_t N, LinOpGraph G, typename LeastSquares, Prox P2>
+std::pair<Func, FuncTuple<N>>
+iterate(const Func& x_in, G& K, LeastSquares& least_squares, std::array<P2, N> psi_fns,
+        const Expr& rho) {
+    // Update w_i for i = 0..N .
+    const FuncTuple<N> Kx = K.forward(x_in);
+    FuncTuple<N> w;
+    ranges::transform(zip_view{Kx, psi_fns}, w.begin(), [=](const auto& args) -> Func {
+        const auto& [_Kx, prox] = args;
+        return prox(_Kx, rho);
+    });
+
+    // Update x.
+    const Func x_new = least_squares(K.adjoint(w), 1.0f / rho);
+
+    return {x_new, w};
+}
+
+/** Compute the convergence metrics of each image in the batch.
+ *
+ * As in half_quadratic_splitting.py, the inner iterations terminate when both
+ * x and w_i stop changing. Returns the norms || x - x_prev ||,
+ * || w - w_prev ||, and the corresponding tolerances, as expressions of the
+ * batch dimension c.
+ */
+template <size_t N>
+std::tuple<Expr, Expr, Expr, Expr>
+computeConvergence(const Func& x_new, const Func& x_prev, const FuncTuple<N>& w,
+                   const FuncTuple<N>& w_prev, const Expr& input_size, const Expr& output_size,
+                   const RDom& output_dimensions, const float eps_abs = 1e-3f,
+                   const float eps_rel = 1e-3f) {
+    using utils::squaredAt;
+    const RDom& r = output_dimensions;
+
+    Func x_diff{"x_diff"};
+    x_diff(x, y, c) = x_new(x, y, c) - x_prev(x, y, c);
+
+    Expr w_sq = 0.0f;
+    Expr w_diff_sq = 0.0f;
+    for (size_t i = 0; i < N; i++) {
+        w_sq += squaredAt(w[i], r);
+
+        const Expr _diff = (w[i].dimensions() == 4)
+                               ? w[i](r.x, r.y, c, r.z) - w_prev[i](r.x, r.y, c, r.z)
+                               : select(r.z == 0, w[i](r.x, r.y, c) - w_prev[i](r.x, r.y, c), 0.0f);
+        w_diff_sq += _diff * _diff;
+    }
+
+    // Compute the norms of x, w, and their changes in one pass.
+    Func norms{"norms"};
+    norms(c) = Tuple{0.0f, 0.0f, 0.0f, 0.0f};
+    norms(c) = Tuple{norms(c)[0] + squaredAt(x_new, r), norms(c)[1] + w_sq,
+                     norms(c)[2] + squaredAt(x_diff, r), norms(c)[3] + w_diff_sq};
+
+    const Expr x_norm = norms(c)[0];
+    const Expr w_norm = norms(c)[1];
+    const Expr r_x = norms(c)[2];
+    const Expr r_w = norms(c)[3];
+
+    const Expr eps_x = eps_rel * sqrt(x_norm) + sqrt(cast<float>(input_size)) * eps_abs;
+    const Expr eps_w = eps_rel * sqrt(w_norm) + sqrt(cast<float>(output_size)) * eps_abs;
+
+    return {sqrt(r_x), sqrt(r_w), eps_x, eps_w};
+}
+
+}  // namespace half_quadratic_splitting
+}  // namespace algorithm
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Halide.h"
+#include "fft/fft.h"
+#include "problem-interface.h"
+#include "vars.h"
+
+using namespace Halide;
+
+namespace algorithm {
+namespace least_squares {
+
+/** Boundary condition of K^T K, at the image borders. */
+enum class Boundary {
+    /** Circulant, e.g. the convolution with the periodic boundary condition. */
+    periodic,
+
+    /** Reflective, e.g. the image gradient with mirror_image, see K_grad_mat.
+     * The operator is diagonalized by the discrete cosine transform (DCT). */
+    neumann,
+};
+
+/** Solve the least-squares problem
+ *
+ *     argmin_v alpha || v - b ||^2 + 1 / (2 lmb) || K v - w ||^2
+ *
+ * with the frequency domain inverse, as in least_square_direct.cpp . The
+ * diagonal of K^T K is the spectrum of its impulse response. The spectrum is
+ * memoized, as it does not depend on the pipeline inputs.
+ *
+ * The boundary condition must be that of K. For Boundary::neumann, the DCT is
+ * computed as the DFT of the mirrored image, of size 2W x 2H: the solution of
+ * the mirrored problem is symmetric, and equals the exact minimizer on
+ * W x H, including at the borders.
+ *
+ * Call the object once per iteration, and then schedule() in the generator's
+ * schedule().
+ */
+template <int W, int H>
+class FrequencyDomainInverse {
+   public:
+    template <typename G>
+    FrequencyDomainInverse(G& K, const Func& b, const float alpha, const Target& target,
+                           const Boundary boundary = Boundary::periodic)
+        : alpha(alpha),
+          target(target),
+          boundary(boundary),
+          N0((boundary == Boundary::neumann) ? 2 * W : W),
+          N1((boundary == Boundary::neumann) ? 2 * H : H) {
+        Func impulse{"impulse"};
+        impulse(x, y, c) = select(x == W / 2 && y == H / 2, 1.0f, 0.0f);
+
+        // Shift the impulse response of K^T K to the origin.
+        const Func KTK_impulse = K.adjoint(K.forward(impulse));
+        Func impulse_response{"impulse_response"};
+        if (boundary == Boundary::periodic) {
+            impulse_response(x, y) = KTK_impulse((x + W / 2) % W, (y + H / 2) % H, 0);
+        } else {
+            // Wrap the compact impulse response around the origin of the
+            // mirrored image.
+            const Expr dx = select(x < W, x, x - N0);
+            const Expr dy = select(y < H, y, y - N1);
+            impulse_response(x, y) =
+                select(abs(dx) < W / 2 && abs(dy) < H / 2,
+                       KTK_impulse(clamp(W / 2 + dx, 0, W - 1), clamp(H / 2 + dy, 0, H - 1), 0),
+                       0.0f);
+        }
+
+        f_impulse_response = fft2d_r2c(impulse_response, N0, N1, target);
+
+        // K^T K is symmetric, so the spectrum is real.
+        ktk_spectrum(x, y) = f_impulse_response(x, y).re();
+
+        // Fourier transform of the offset b, constant across the iterations.
+        Func _b = extend(b, "b");
+
+        Fft2dDesc fwd_desc{};
+        fwd_desc.parallel = true;
+        f_b = fft2d_r2c(_b, N0, N1, target, fwd_desc);
+    }
+
+    /** Compute v, given KTw = K^T w . */
+    Func operator()(const Func& KTw, const Expr& lmb) {
+        const Expr rho = 2.0f * alpha * lmb;
+
+        Fft2dDesc fwd_desc{};
+        fwd_desc.parallel = true;
+        ComplexFunc f_KTw = fft2d_r2c(extend(KTw, "KTw"), N0, N1, target, fwd_desc);
+
+        ComplexFunc weighted_average{"weighted_average"};
+        weighted_average(x, y, c) =
+            (f_KTw(x, y, c) / rho + f_b(x, y, c)) / (ktk_spectrum(x, y) / rho + 1.0f);
+
+        // Inverse DFT
+        Fft2dDesc inv_desc{};
+        inv_desc.gain = 1.0f / (N0 * N1);
+        inv_desc.parallel = true;
+
+        // Only the W x H image is read from the mirrored solution, if any.
+        Func inversed = fft2d_c2r(weighted_average, N0, N1, target, inv_desc);
+
+        weighted_averages.push_back(weighted_average);
+        solutions.push_back(inversed);
+        return inversed;
+    }
+
+    void schedule() {
+        const auto vec_width = natural_vector_size<float>();
+
+        // Compute the spectrum of K^T K only once.
+        ktk_spectrum.compute_root().vectorize(x, vec_width).parallel(y).memoize();
+        f_impulse_response.compute_at(ktk_spectrum, Var::outermost());
+
+        f_b.compute_root().parallel(c);
+
+        for (auto& f : weighted_averages) {
+            f.compute_root().vectorize(x, vec_width).parallel(y).parallel(c);
+        }
+
+        // The FFT reads the whole image. Store the solutions.
+        for (auto& f : solutions) {
+            f.compute_root().parallel(c);
+        }
+    }
+
+   private:
+    const float alpha;
+    const Target target;
+    const Boundary boundary;
+
+    /** Size of the DFT: the image size, or that of the mirrored image. */
+    const int N0;
+    const int N1;
+
+    /** The image f on the domain of the DFT. */
+    Func extend(const Func& f, const std::string& name) const {
+        Func extended{name};
+        if (boundary == Boundary::periodic) {
+            extended(x, y, c) = f(x, y, c);
+        } else {
+            using Halide::BoundaryConditions::mirror_image;
+            extended(x, y, c) = mirror_image(f, {{0, W}, {0, H}})(x, y, c);
+        }
+        return extended;
+    }
+
+    ComplexFunc f_impulse_response{"f_impulse_response"};
+    Func ktk_spectrum{"ktk_spectrum"};
+    ComplexFunc f_b{"f_b"};
+
+    std::vector<ComplexFunc> weighted_averages;
+    std::vector<Func> solutions;
+};
+
+}  // namespace least_squares
+}  // namespace algorithm
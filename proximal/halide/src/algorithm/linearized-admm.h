@@ -1,3 +1,5 @@
+#pragma once
+
 #include <utility>
 
 #include "Halide.h"
@@ -7,53 +9,122 @@
 #include "problem-interface.h"
 #include "range/v3/algorithm/transform.hpp"
 #include "range/v3/view/zip.hpp"
+#include "reduction.h"
+#include "utils.h"
 #include "vars.h"
 
 using namespace Halide;
 using ranges::zip_view;
 
-namespace utils {
-Func
-normSquared(const Func& v, const RDom& r) {
-    Func sumsq{"sumsq"};
-    sumsq(x) = 0.0f;
+namespace algorithm {
+namespace linearized_admm {
 
-    if (v.dimensions() == 4) {
-        sumsq(x) += v(r.x, r.y, r.z, r.w) * v(r.x, r.y, r.z, r.w);
-    } else {  // n_dim == 3
-        sumsq(x) += v(r.x, r.y, r.z) * v(r.x, r.y, r.z);
-    }
+/** Update policies of the linearized ADMM iteration. */
+namespace policy {
+
+/** The plain L-ADMM update. */
+struct Plain {};
+
+/** Over-relaxed update.
+ *
+ * Replace K v by alpha K v + (1 - alpha) z in the z_i, u_i updates, with the
+ * relaxation parameter alpha in (1, 2). Reference: Boyd et al. (2011), section
+ * 3.4.3 .
+ */
+struct OverRelaxed {
+    Expr alpha;
+};
+
+/** Accelerated update, with momentum.
+ *
+ * Extrapolate z_i, u_i from the previous iterates z_prev, u_prev before the
+ * update. The momentum is computed, and reset to zero on restart, by the
+ * caller. Reference: Goldstein et al. (2014), "Fast alternating direction
+ * optimization methods".
+ */
+template <size_t N>
+struct Accelerated {
+    Expr momentum;
+    FuncTuple<N> z_prev;
+    FuncTuple<N> u_prev;
+};
 
-    return sumsq;
+}  // namespace policy
+
+namespace {
+
+template <size_t N, typename Policy>
+std::pair<FuncTuple<N>, FuncTuple<N>>
+extrapolate(const FuncTuple<N>& z, const FuncTuple<N>& u, const Policy&) {
+    return {z, u};
 }
 
 template <size_t N>
-Func
-normSquared(const FuncTuple<N>& v, const RDom& r) {
-    Func sumsq{"sumsq"};
-    sumsq(x) = 0.0f;
-
-    for (const auto& _v : v) {
-        if (_v.dimensions() == 4) {
-            sumsq(x) += _v(r.x, r.y, r.z, r.w) * _v(r.x, r.y, r.z, r.w);
-        } else {  // n_dim == 3
-            sumsq(x) += _v(r.x, r.y, r.z) * _v(r.x, r.y, r.z);
-        }
-    }
+std::pair<FuncTuple<N>, FuncTuple<N>>
+extrapolate(const FuncTuple<N>& z, const FuncTuple<N>& u, const policy::Accelerated<N>& p) {
+    using Vars = std::vector<Var>;
 
-    return sumsq;
+    const auto momentum = [&](const FuncTuple<N>& w, const FuncTuple<N>& w_prev,
+                              const char* name) -> FuncTuple<N> {
+        FuncTuple<N> w_hat;
+        ranges::transform(zip_view{w, w_prev}, w_hat.begin(), [&](const auto& args) -> Func {
+            const auto& [_w, _w_prev] = args;
+            const auto vars = (_w.dimensions() == 4) ? Vars{x, y, c, k} : Vars{x, y, c};
+
+            Func _w_hat{name};
+            _w_hat(vars) = _w(vars) + p.momentum * (_w(vars) - _w_prev(vars));
+            return _w_hat;
+        });
+        return w_hat;
+    };
+
+    return {momentum(z, p.z_prev, "z_hat"), momentum(u, p.u_prev, "u_hat")};
 }
-}  // namespace utils
 
-namespace algorithm {
-namespace linearized_admm {
+template <size_t N, typename Policy>
+FuncTuple<N>
+relax(const FuncTuple<N>& Kv, const FuncTuple<N>&, const Policy&) {
+    return Kv;
+}
+
+template <size_t N>
+FuncTuple<N>
+relax(const FuncTuple<N>& Kv, const FuncTuple<N>& z, const policy::OverRelaxed& p) {
+    using Vars = std::vector<Var>;
 
-template <size_t N, LinOpGraph G, Prox P, Prox P2>
-std::tuple<Func, FuncTuple<N>, FuncTuple<N>>
-iterate(const Func& v, const FuncTuple<N>& z, const FuncTuple<N>& u, G& K, const P& omega_fn,
-        std::array<P2, N> psi_fns, const Expr& lmb, const Expr& mu, const Func& b) {
+    FuncTuple<N> Kv_hat;
+    ranges::transform(zip_view{Kv, z}, Kv_hat.begin(), [&](const auto& args) -> Func {
+        const auto& [_Kv, _z] = args;
+        const auto vars = (_z.dimensions() == 4) ? Vars{x, y, c, k} : Vars{x, y, c};
+
+        Func _Kv_hat{"Kv_hat"};
+        _Kv_hat(vars) = p.alpha * _Kv(vars) + (1.0f - p.alpha) * _z(vars);
+        return _Kv_hat;
+    });
+    return Kv_hat;
+}
+
+}  // namespace
+
+/** One iteration of the linearized ADMM algorithm.
+ *
+ * The update is selected by the policy: one of policy::Plain,
+ * policy::OverRelaxed, or policy::Accelerated.
+ *
+ * Returns the updated v, z_i, u_i, and also K v_new, so that the caller can
+ * re-use the forward product to compute the convergence metrics.
+ */
+template <size_t N, LinOpGraph G, Prox P, Prox P2, typename Policy = policy::Plain>
+std::tuple<Func, FuncTuple<N>, FuncTuple<N>, FuncTuple<N>>
+iterate(const Func& v, const FuncTuple<N>& z_in, const FuncTuple<N>& u_in, G& K,
+        const P& omega_fn, std::array<P2, N> psi_fns, const Expr& lmb, const Expr& mu,
+        const Func& b, const Policy& update_policy = {}) {
     using Vars = std::vector<Var>;
 
+    FuncTuple<N> z;
+    FuncTuple<N> u;
+    std::tie(z, u) = extrapolate(z_in, u_in, update_policy);
+
     // Update v
     Func v_new{"v_new"};
     {
@@ -81,8 +152,9 @@ iterate(const Func& v, const FuncTuple<N>& z, const FuncTuple<N>& u, G& K, const
 
     // Update z_i for i = 0..N .
     const FuncTuple<N> Kv2 = K.forward(v_new);
+    const FuncTuple<N> Kv2_hat = relax(Kv2, z, update_policy);
     FuncTuple<N> z_new;
-    ranges::transform(zip_view{Kv2, u, psi_fns}, z_new.begin(), [=](const auto& args) -> Func {
+    ranges::transform(zip_view{Kv2_hat, u, psi_fns}, z_new.begin(), [=](const auto& args) -> Func {
         // We resort to the ranges::transform() syntax because MacOS+clang14
         // refuses to reference z_new using the structured binding syntax
         // `auto&& [...]`. Instead, the compiler makes a copy of z_new, so we
@@ -98,7 +170,7 @@ iterate(const Func& v, const FuncTuple<N>& z, const FuncTuple<N>& u, G& K, const
 
     // Update u.
     FuncTuple<N> u_new;
-    ranges::transform(zip_view{u, Kv2, z_new, psi_fns}, u_new.begin(), [=](const auto& args) -> Func {
+    ranges::transform(zip_view{u, Kv2_hat, z_new, psi_fns}, u_new.begin(), [=](const auto& args) -> Func {
         const auto& [_u, _Kv, _z, prox] = args;
         const auto vars = (prox.n_dim == 4) ? Vars{x, y, c, k} : Vars{x, y, c};
 
@@ -108,32 +180,31 @@ iterate(const Func& v, const FuncTuple<N>& z, const FuncTuple<N>& u, G& K, const
         return _u_new;
     });
 
-    return {v_new, z_new, u_new};
+    return {v_new, z_new, u_new, Kv2};
 }
 
+/** Compute the convergence metrics of each image in the batch.
+ *
+ * Kv is the forward product K v, as returned by iterate(). All five norms are
+ * computed in a single pass over the images, so that the convergence check
+ * reads v, z_i, u_i only once. The sums are deterministic for any number of
+ * threads, see reduction::sum2D(); with schedule_reduction = false, e.g. for
+ * the auto-scheduler, they are left unscheduled.
+ *
+ * Returns the primal residual r, dual residual s, and the corresponding
+ * tolerances, as expressions of the batch dimension c.
+ */
 template <size_t N, LinOpGraph G>
 std::tuple<Expr, Expr, Expr, Expr>
-computeConvergence(const Func& v, const FuncTuple<N>& z, const FuncTuple<N>& u,
-                   const FuncTuple<N>& z_prev, G& K, const float lmb, const uint32_t input_size,
-                   const RDom& input_dimensions, const uint32_t output_size,
-                   const RDom& output_dimensions, const float eps_abs = 1e-3f,
-                   const float eps_rel = 1e-3f) {
+computeConvergence(const FuncTuple<N>& Kv, const FuncTuple<N>& z, const FuncTuple<N>& u,
+                   const FuncTuple<N>& z_prev, G& K, const Expr& lmb, const Expr& input_size,
+                   const Expr& output_size, const RDom& output_dimensions,
+                   const float eps_abs = 1e-3f, const float eps_rel = 1e-3f,
+                   const bool schedule_reduction = true) {
     using Vars = std::vector<Var>;
 
-    const FuncTuple<N> Kv = K.forward(v);
     const Func KTu = K.adjoint(u);
 
-    // Compute primal residual
-    FuncTuple<N> r;
-    ranges::transform(zip_view{Kv, z}, r.begin(), [](const auto& args) -> Func {
-        const auto& [_Kv, _z] = args;
-        const auto vars = (_z.dimensions() == 4) ? Vars{x, y, c, k} : Vars{x, y, c};
-
-        Func _r{"r"};
-        _r(vars) = _Kv(vars) - _z(vars);
-        return _r;
-    });
-
     FuncTuple<N> ztmp;
     ranges::transform(zip_view{z, z_prev}, ztmp.begin(), [=](const auto& args) -> Func {
         const auto& [_z, _z_prev] = args;
@@ -148,21 +219,51 @@ computeConvergence(const Func& v, const FuncTuple<N>& z, const FuncTuple<N>& u,
     // Compute dual residual
     const Func s = K.adjoint(ztmp);
 
-    // Compute convergence criteria
-    using utils::normSquared;
+    // Compute the norms of Kv, z, K^T u, primal and dual residuals in one pass,
+    // with the 4th dimension k flattened into the rows of the reduction.
+    using utils::squaredAt;
+    const RDom& r = output_dimensions;
+    const Expr height = r.y.extent();
+
+    Var xr{"xr"}, yr{"yr"};
+    const Expr _y = yr % height;
+    const Expr _k = yr / height;
+
+    Expr Kv_sq = 0.0f;
+    Expr z_sq = 0.0f;
+    Expr r_sq = 0.0f;
+    for (size_t i = 0; i < N; i++) {
+        Kv_sq += squaredAt(Kv[i], xr, _y, _k);
+        z_sq += squaredAt(z[i], xr, _y, _k);
+
+        // Primal residual
+        const Expr _r = (z[i].dimensions() == 4)
+                            ? Kv[i](xr, _y, c, _k) - z[i](xr, _y, c, _k)
+                            : select(_k == 0, Kv[i](xr, _y, c) - z[i](xr, _y, c), 0.0f);
+        r_sq += _r * _r;
+    }
 
-    const Func Kv_norm = normSquared(Kv, output_dimensions);
-    const Func z_norm = normSquared(z, output_dimensions);
+    Func norm_terms{"norm_terms"};
+    norm_terms(xr, yr, c) = Tuple{Kv_sq, z_sq, squaredAt(KTu, xr, _y, _k), r_sq,
+                                  squaredAt(s, xr, _y, _k)};
+
+    const Func norms = reduction::sum2D(norm_terms, r.x.extent(), height * r.z.extent(), "norms",
+                                        schedule_reduction);
+
+    const Expr Kv_norm = norms(c)[0];
+    const Expr z_norm = norms(c)[1];
+    const Expr KTu_norm = norms(c)[2];
+    const Expr r_norm = norms(c)[3];
+    const Expr s_norm = norms(c)[4];
+
+    // Compute convergence criteria
     const Expr eps_pri =
-        eps_rel * sqrt(max(Kv_norm(0), z_norm(0))) + std::sqrt(float(output_size)) * eps_abs;
+        eps_rel * sqrt(max(Kv_norm, z_norm)) + sqrt(cast<float>(output_size)) * eps_abs;
 
-    const Func KTu_norm = normSquared(KTu, input_dimensions);
     const Expr eps_dual =
-        sqrt(KTu_norm(0)) * eps_rel / (1.0f / lmb) + std::sqrt(float(input_size)) * eps_abs;
+        sqrt(KTu_norm) * eps_rel / (1.0f / lmb) + sqrt(cast<float>(input_size)) * eps_abs;
 
-    const Func r_norm = normSquared(r, output_dimensions);
-    const Func s_norm = normSquared(s, input_dimensions);
-    return {sqrt(r_norm(0)), sqrt(s_norm(0)), eps_pri, eps_dual};
+    return {sqrt(r_norm), sqrt(s_norm), eps_pri, eps_dual};
 }
 }  // namespace linearized_admm
 }  // namespace algorithm
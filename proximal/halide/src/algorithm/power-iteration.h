@@ -0,0 +1,38 @@
+#pragma once
+
+#include <utility>
+
+#include "Halide.h"
+#include "problem-interface.h"
+#include "utils.h"
+#include "vars.h"
+
+using namespace Halide;
+
+namespace algorithm {
+namespace power_iteration {
+
+/** One step of the power iteration on K^T K.
+ *
+ * Returns K^T K v normalized to the unit norm, and the norm || K^T K v || of
+ * each image in the batch. When v is of unit norm, the latter converges to the
+ * largest eigenvalue of K^T K, i.e. the squared operator norm || K ||^2 .
+ */
+template <size_t N, LinOpGraph G>
+std::tuple<Func, Func>
+iterate(const Func& v, G& K, const RDom& input_dimensions) {
+    const Func KTKv = K.adjoint(K.forward(v));
+
+    const Func KTKv_norm_sq = utils::normSquared(KTKv, input_dimensions);
+    Func KTKv_norm{"KTKv_norm"};
+    KTKv_norm(c) = sqrt(KTKv_norm_sq(c));
+
+    // Guard against the null space of K.
+    Func v_new{"v_new"};
+    v_new(x, y, c) = KTKv(x, y, c) / max(KTKv_norm(c), 1e-12f);
+
+    return {v_new, KTKv_norm};
+}
+
+}  // namespace power_iteration
+}  // namespace algorithm
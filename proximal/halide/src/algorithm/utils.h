@@ -0,0 +1,71 @@
+#pragma once
+
+#include "Halide.h"
+#include "problem-interface.h"
+#include "vars.h"
+
+using namespace Halide;
+
+namespace utils {
+/** Sum of squares of each image in the batch.
+ *
+ * The reduction domain r spans the image width and height, and optionally the
+ * 4th dimension k. The batch dimension c remains a pure variable, so that each
+ * image converges independently.
+ */
+inline Func
+normSquared(const Func& v, const RDom& r) {
+    Func sumsq{"sumsq"};
+    sumsq(c) = 0.0f;
+
+    if (v.dimensions() == 4) {
+        sumsq(c) += v(r.x, r.y, c, r.z) * v(r.x, r.y, c, r.z);
+    } else {  // n_dim == 3
+        sumsq(c) += v(r.x, r.y, c) * v(r.x, r.y, c);
+    }
+
+    return sumsq;
+}
+
+template <size_t N>
+Func
+normSquared(const FuncTuple<N>& v, const RDom& r) {
+    Func sumsq{"sumsq"};
+    sumsq(c) = 0.0f;
+
+    for (const auto& _v : v) {
+        if (_v.dimensions() == 4) {
+            sumsq(c) += _v(r.x, r.y, c, r.z) * _v(r.x, r.y, c, r.z);
+        } else {  // n_dim == 3
+            sumsq(c) += _v(r.x, r.y, c) * _v(r.x, r.y, c);
+        }
+    }
+
+    return sumsq;
+}
+
+/** Squared value of v at the coordinates (_x, _y, _k) of the width, height
+ * and the 4th dimension k.
+ *
+ * 3D data are counted once, at k == 0, so that the 3D and 4D squares can be
+ * summed in the same reduction pass.
+ */
+inline Expr
+squaredAt(const Func& v, const Expr& _x, const Expr& _y, const Expr& _k) {
+    if (v.dimensions() == 4) {
+        const Expr _v = v(_x, _y, c, _k);
+        return _v * _v;
+    }
+
+    // n_dim == 3
+    const Expr _v = v(_x, _y, c);
+    return select(_k == 0, _v * _v, 0.0f);
+}
+
+/** Squared value of v at the reduction domain r, spanning the width, height
+ * and the 4th dimension k. */
+inline Expr
+squaredAt(const Func& v, const RDom& r) {
+    return squaredAt(v, r.x, r.y, r.z);
+}
+}  // namespace utils
@@ -0,0 +1,67 @@
+////////////////////////////////////////////////////////////////////////////////
+//Full reductions used by the conjugate gradient (CG): dot product and L2 norm.
+//The sums are deterministic, see reduction.h.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "vars.h"
+#include "reduction.h"
+
+namespace {
+
+//Number of elements per row of 1D data, such that long vectors are also
+//reduced in parallel.
+const int chunk_width = 1024;
+
+//Full reduction of f over width x height x ch, with the channels flattened into
+//rows of the reduction. With is1D, each row of f is also split into chunks.
+Func full_sum(Func f, Expr width, Expr height, Expr ch, bool is1D, const std::string& name)
+{
+	Var xr("xr"), yr("yr");
+
+	Func term(name + "_term");
+	if (!is1D) {
+		term(xr, yr) = f(xr, yr % height, yr / height);
+		return reduction::sum2D(term, width, height * ch, name);
+	}
+
+	Expr n_chunks = (width + chunk_width - 1) / chunk_width;
+	Expr xf = (yr % n_chunks) * chunk_width + xr;
+	Expr yf = yr / n_chunks;
+	term(xr, yr) = select(xf < width, f(min(xf, width - 1), yf % height, yf / height), 0.0f);
+
+	return reduction::sum2D(term, chunk_width, n_chunks * height * ch, name);
+}
+
+//Full reduction. The name must be unique in the pipeline.
+Func dot_prod(Func A, Func B, Expr width, Expr height, Expr ch, bool is1D=false,
+	const std::string& name="resdot")
+{
+	Func input_square(name + "_square");
+	input_square(x, y, c) = A(x, y, c) * B(x, y, c) ;
+
+	Func result(name);
+	result() = full_sum(input_square, width, height, ch, is1D, name + "_sum")();
+	result.compute_root();
+
+	return result;
+}
+
+//Full reduction. The name must be unique in the pipeline.
+Func norm_L2(Func input, Expr width, Expr height, Expr ch, bool is1D=false,
+	const std::string& name="resnorm")
+{
+	//Square
+	Func input_square(name + "_square");
+	input_square(x, y, c) = input(x, y, c) * input(x, y, c) ;
+
+	//Reduction
+	Func resnorm(name);
+	resnorm() = sqrt( full_sum(input_square, width, height, ch, is1D, name + "_sum")() );
+	resnorm.compute_root();
+
+	return resnorm;
+}
+
+} // namespace
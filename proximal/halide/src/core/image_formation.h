@@ -54,6 +54,45 @@ Func At_conv(Func input, Expr width, Expr height, Func K, Expr filter_width, Exp
     return img_conv;
 }
 
+//AtA via convolution, with the mask MtM in between: At_conv(MtM * A_conv(x)).
+//Fused, such that the intermediate A x is computed per strip of rows of the
+//result, plus the kernel support, instead of for the whole image. The result
+//is scheduled here, and cannot be inlined in the consumer.
+Func AtA_conv(Func input, Expr width, Expr height, Func K, Expr filter_width, Expr filter_height, Func MtM) {
+
+    const int vec_width = 8;
+
+    //Clamped
+    Func img_bounded("img_bounded");
+    img_bounded = BoundaryConditions::repeat_image(input, {{0, width}, {0, height}});
+
+    Func mask_bounded("mask_bounded");
+    mask_bounded = BoundaryConditions::repeat_image(MtM, {{0, width}, {0, height}});
+
+    //Define the convolution
+    Func img_conv("img_conv");
+    RDom rf(0, filter_width, 0, filter_height);
+    img_conv(x, y, c) = sum(img_bounded(x - rf.x + filter_width / 2, y - rf.y + filter_height / 2, c) * K(rf.x, rf.y, c));
+
+    //Masked. Periodic, same as the circular boundary condition of At_conv
+    Func img_masked("img_masked");
+    img_masked(x, y, c) = mask_bounded(x, y, c) * img_conv(x, y, c);
+
+    //Define the convolution with the flipped kernel
+    Func img_conv_trans("AtA_conv");
+    RDom rt(0, filter_width, 0, filter_height);
+    img_conv_trans(x, y, c) = sum(img_masked(x - rt.x + filter_width / 2, y - rt.y + filter_height / 2, c) * K(filter_width - 1 - rt.x, filter_height - 1 - rt.y, c));
+
+    // Schedule
+    Var yo, yi;
+    img_conv_trans.split(y, yo, yi, 32, TailStrategy::GuardWithIf)
+        .vectorize(x, vec_width)
+        .parallel(yo);
+    img_masked.compute_at(img_conv_trans, yo).vectorize(x, vec_width);
+
+    return img_conv_trans;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Mask
 ////////////////////////////////////////////////////////////////////////////////
@@ -73,28 +112,13 @@ Func At_M(Func input, Expr width, Expr height, Func mask) {
     return A_M(input, width, height, mask);
 }
 
-//Mask application
+//Mask application, fused: M^T M x in one pass, without the intermediate M x
 Func AtA_M(Func input, Expr width, Expr height, Func mask) {
 
-    int vec_width = 8;
-
 	//Define the mask
     Func input_mask("input_mask");
     input_mask(x, y, c) = mask(x, y, c) * mask(x, y, c) * input(x, y, c);
 
-    std::cout << "Finished AtA_mask setup." << std::endl;
-
-    // Schedule
-    input_mask.reorder(c, y, x);
-    input_mask.vectorize(y, vec_width);
-	input_mask.parallel(x);
-
-	//input_mask.unroll(c,3);
-
-	input_mask.print_loop_nest();
-
-
-    
     return input_mask;
 }
 
@@ -182,4 +206,30 @@ Func At_warpHomography(Func input, Expr width, Expr height, Func Hinv, Expr nhom
     return resampledAtSum;
 }
 
+//AtA via warping, with the mask MtM in between: At_warp(MtM * A_warp(x)).
+//Fused, such that the mask is applied on the fly to the warped images. The
+//source pixels of the adjoint warp depend on Hinv at run time, so the masked
+//warped images are computed once for the whole image, in parallel strips.
+Func AtA_warpHomography(Func input, Expr width, Expr height, Func H, Func Hinv, Expr nhom, Func MtM) {
+
+    const int vec_width = 8;
+
+    //Warped and masked
+    Func warped = A_warpHomography(input, width, height, H, nhom);
+
+    Func warped_masked("warped_masked");
+    warped_masked(x, y, c, g) = MtM(x, y, c) * warped(x, y, c, g);
+
+    Func warped_trans = At_warpHomography(warped_masked, width, height, Hinv, nhom);
+
+    // Schedule, in the same axes as the warp generators
+    Var xo;
+    warped_masked.compute_root()
+        .split(x, xo, x, 32)
+        .parallel(xo)
+        .vectorize(y, vec_width);
+
+    return warped_trans;
+}
+
 } // namespace
\ No newline at end of file
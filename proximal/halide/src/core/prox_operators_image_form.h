@@ -1,13 +1,14 @@
 ////////////////////////////////////////////////////////////////////////////////
 //This file contains all proximal operators involving the image formation operators.
-//Currently all image formation proximal operators are computed via CG. The two CG 
-//implementations in this file are identical except for the function call of A^T*A,
+//Currently all image formation proximal operators are computed via CG. The CG
+//is split into the initial residual and one CG step, such that the run time
+//calls one pipeline per iteration, and stops as soon as the residual is small
+//enough. The image formation operators differ only in the function Mfun(p),
 //where A is here the concatenation of all image formation matrices.
 ////////////////////////////////////////////////////////////////////////////////
 
 #pragma once
 
-namespace {
 //Vars
 #include "vars.h"
 
@@ -20,377 +21,200 @@ namespace {
 //CG utils
 #include "CG_utils.h"
 
+namespace {
+
 ////////////////////////////////////////////////////////////////////////////////
-//proximal operator (based on conjugate gradient) for convolution + mask
+//Conjugate gradient, for the linear system Mfun(x) = b
 ////////////////////////////////////////////////////////////////////////////////
 
-//CG with iteration labels
-std::vector<Func>  CG_conv(Func xin_func, Func Atb, Func K_func, Func MtM_func, 
-        Expr width, Expr height, Expr ch, Expr width_kernel, Expr height_kernel, 
-        Expr beta_cg, 
-        int cgiters, int outter_iter)
+//Initial residual
+// r = b - Mfun(x)
+template <typename MfunT>
+Func CG_residual(Func xin_func, Func b_func, MfunT Mfun)
 {
-        //Outer iteration number
-        std::string oitstr = std::to_string(outter_iter);
+        Func Mfun_x = Mfun(xin_func);
 
-        //Compute b
-        // b = beta_cg * AtB + f
-        Func b_func("b_cg" + oitstr);
-        b_func(x, y, c) = beta_cg * Atb(x, y, c) + xin_func(x, y, c);
+        Func r("r_cg");
+        r(x, y, c) = b_func(x, y, c) - Mfun_x(x, y, c);
 
-        // Compute residual
-        // r = b - Mfun(x)
-        Func r("r_cg" + oitstr);
-        Func AtA_x("AtA_x_cg" + oitstr);
-        AtA_x = AtA_conv(xin_func, width, height, K_func, width_kernel, height_kernel, MtM_func);
+        return r;
+}
 
-        Func Mfun_x("Mfun_x_" + oitstr);
-        Mfun_x(x, y, c) = beta_cg * AtA_x(x, y, c) + xin_func(x, y, c);
+//Iterates of one CG step, and the scalar state for the next step
+struct CG_state {
+        Func x;
+        Func r;
+        Func p;
+        Func rho;
+        Func norm_r;
+};
+
+//One (preconditioned) CG step. z is the preconditioned residual, i.e. the
+//residual r solved with the preconditioner, or r itself without. The scalar
+//rho_prev = r'*z of the previous step, or zero in the first step, such that
+//p = z regardless of the previous p.
+template <typename MfunT>
+CG_state CG_step(Func x_func, Func r_func, Func z_func, Func p_func, Expr rho_prev,
+        MfunT Mfun, Expr width, Expr height, Expr ch)
+{
+        const int vec_width = 8;
 
-        r(x, y, c) = b_func(x, y, c) - Mfun_x(x, y, c);
+        //Compute rho
+        // rho = (r(:)'*z(:));
+        Func rho("rho_cg");
+        rho() = dot_prod(r_func, z_func, width, height, ch, false, "rz_dot")();
 
-        
-        //Schedule r
-        r.vectorize(x, 4);
-        Var yo, yi;
-        r.split(y, yo, y, 32).parallel(yo);
-        r.compute_root();
-        
-        ///////////////////////////////////////////////////////////////////
-        // Do iterations
-        ///////////////////////////////////////////////////////////////////
-        
-        //Iterates (iteration plus potentially initial value)
-        Func rho[cgiters + 1];
-        Func p[cgiters + 1];
-        Func r_func[cgiters + 1];
-        Func x_func[cgiters + 1];
-
-        //Intial iterate and residual
-        x_func[0] = xin_func;
-        r_func[0] = r;
-
-        for( int it = 1; it <= cgiters; it++ )
-        {
-            //Output
-            std::string itstr = std::to_string(it);
-            std::cout << "Scheduling iteration [" << it << "/" << cgiters << "]" << std::endl;
-
-            //Compute rho
-            // rho = (r(:)'*r(:));
-            rho[it] = Func( "rho_cg_" + itstr + "_" + oitstr );
-            rho[it]() = dot_prod(r_func[it - 1], r_func[it - 1], width, height, ch);
-
-            //Compute p
-            p[it] = Func("p_cg_" + itstr + "_" + oitstr  );
-            if( it == 1 )
-            {
-                // p = r
-                p[it](x, y, c) = r_func[it - 1](x, y, c);
-            }
-            else
-            {
-                // p = r + (rho / rho_1)*p;
-                p[it](x, y, c) = r_func[it - 1](x, y, c) + ( rho[it]() / rho[it - 1]() ) * p[it - 1](x, y, c);
-            }
-            
-            //Compute q = Ap
-            //q = Mfun(p);
-            Func AtA_p("AtA_p_cg_" + itstr + "_" + oitstr );
-            AtA_p = AtA_conv(p[it], width, height, K_func, width_kernel, height_kernel, MtM_func);
-
-            Func q("q_cg_" + itstr + "_" + oitstr  );
-            q(x, y, c) = beta_cg * AtA_p(x, y, c) + p[it](x, y, c);
-
-
-            
-            //Compute alpha
-            //alpha = rho / (p(:)'*q(:) );
-            Func pq("pq_cg_" + itstr + "_" + oitstr  );
-            pq() = dot_prod(p[it], q, width, height, ch);
-            
-            Func alpha("alpha_cg_" + itstr  + "_" + oitstr );
-            alpha() = rho[it]() / pq();
-            
-            //Compute x
-            //x = x + alpha * p; % update approximation vector
-            x_func[it] = Func("xout_cg_" + itstr + "_" + oitstr );
-            x_func[it](x,y,c) = x_func[it - 1](x,y,c) + alpha() * p[it](x,y,c);
-            
-            //Compute r
-            //r = r - alpha*q;  ; % compute residual
-            r_func[it] = Func("rout_cg_" + itstr + "_" + oitstr );
-            r_func[it](x,y,c) = r_func[it - 1](x,y,c) - alpha() * q(x,y,c);
-            
-            //Schedule r
-            x_func[it].compute_root();
-            r_func[it].compute_root();
-        }
-
-        //Compute the norm of r for final iterate
+        //Compute p
+        // p = z + (rho / rho_1)*p;
+        Func p("p_cg");
+        p(x, y, c) = select(rho_prev > 0.0f, z_func(x, y, c) + (rho() / rho_prev) * p_func(x, y, c), z_func(x, y, c));
+
+        //Compute q = Ap
+        //q = Mfun(p);
+        Func q = Mfun(p);
+
+        //Compute alpha
+        //alpha = rho / (p(:)'*q(:) );
+        Func pq("pq_cg");
+        pq() = dot_prod(p, q, width, height, ch, false, "pq_dot")();
+
+        Func alpha("alpha_cg");
+        alpha() = rho() / pq();
+
+        //Compute x
+        //x = x + alpha * p; % update approximation vector
+        Func x_next("xout_cg");
+        x_next(x, y, c) = x_func(x, y, c) + alpha() * p(x, y, c);
+
+        //Compute r
+        //r = r - alpha*q;  ; % compute residual
+        Func r_next("rout_cg");
+        r_next(x, y, c) = r_func(x, y, c) - alpha() * q(x, y, c);
+
+        //Compute the norm of r for the convergence check
         Func norm_r("norm_r");
-        norm_r() = norm_L2(r_func[cgiters], width, height, ch);
-
-        std::vector<Func> outputs;
-        outputs.push_back(x_func[cgiters]); 
-        outputs.push_back(norm_r);     
-        
-        //Compute the norm of r for final iterate
-        //return x_func[cgiters];
-        return outputs;
+        norm_r() = norm_L2(r_next, width, height, ch, false, "r_norm")();
+
+        //Schedule
+        rho.compute_root();
+        Var yo, yi;
+        p.compute_root()
+            .split(y, yo, yi, 32, TailStrategy::GuardWithIf)
+            .vectorize(x, vec_width)
+            .parallel(yo);
+        alpha.compute_root();
+
+        return {x_next, r_next, p, rho, norm_r};
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-//proximal operator (based on conjugate gradient) for warp + mask
+//proximal operator (based on conjugate gradient) for convolution + mask
 ////////////////////////////////////////////////////////////////////////////////
 
-//CG with iteration labels
-std::vector<Func>  CG_warp(Func xin_func, Func Atb, Func H_func, Func Hinv_func, Func MtM_func, 
-        Expr width, Expr height, Expr ch, Expr nhom, 
-        Expr beta_cg, 
-        int cgiters, int outter_iter)
+//Right hand side
+// b = beta_cg * AtB + f
+Func CG_conv_rhs(Func xin_func, Func Atb, Expr beta_cg)
 {
-        //Outer iteration number
-        std::string oitstr = std::to_string(outter_iter);
-
-        //Compute b
-        // b = beta_cg * AtB + f
-        Func b_func("b_cg" + oitstr);
+        Func b_func("b_cg");
         b_func(x, y, c) = beta_cg * Atb(x, y, c) + xin_func(x, y, c);
 
-        // Compute residual
-        // r = b - Mfun(x)
-        Func r("r_cg" + oitstr);
-        Func AtA_x("AtA_x_cg" + oitstr);
-        AtA_x = AtA_warpHomography(xin_func, width, height, H_func, Hinv_func, nhom, MtM_func);
-        Func Mfun_x("Mfun_x_" + oitstr);
-        Mfun_x(x, y, c) = beta_cg * AtA_x(x, y, c) + xin_func(x, y, c);
+        return b_func;
+}
 
-        r(x, y, c) = b_func(x, y, c) - Mfun_x(x, y, c);
+//Mfun(p) = beta_cg * A^T A p + p, with A = M * K
+auto CG_conv_Mfun(Func K_func, Func MtM_func, Expr width, Expr height,
+        Expr width_kernel, Expr height_kernel, Expr beta_cg)
+{
+        return [=](Func p) {
+            //AtA_conv is scheduled in tiles, and cannot be inlined.
+            Func AtA_p = AtA_conv(p, width, height, K_func, width_kernel, height_kernel, MtM_func);
+            AtA_p.compute_root();
+
+            Func q("q_cg");
+            q(x, y, c) = beta_cg * AtA_p(x, y, c) + p(x, y, c);
+            return q;
+        };
+}
 
-        
-        //Schedule r
-        r.vectorize(x, 4);
-        Var yo, yi;
-        r.split(y, yo, y, 32).parallel(yo);
-        r.compute_root();
-        
-        ///////////////////////////////////////////////////////////////////
-        // Do iterations
-        ///////////////////////////////////////////////////////////////////
-        
-        //Iterates (iteration plus potentially initial value)
-        Func rho[cgiters + 1];
-        Func p[cgiters + 1];
-        Func r_func[cgiters + 1];
-        Func x_func[cgiters + 1];
-
-        //Intial iterate and residual
-        x_func[0] = xin_func;
-        r_func[0] = r;
-
-        for( int it = 1; it <= cgiters; it++ )
-        {
-            //Output
-            std::string itstr = std::to_string(it);
-            std::cout << "Scheduling iteration [" << it << "/" << cgiters << "]" << std::endl;
-
-            //Compute rho
-            // rho = (r(:)'*r(:));
-            rho[it] = Func( "rho_cg_" + itstr + "_" + oitstr );
-            rho[it]() = dot_prod(r_func[it - 1], r_func[it - 1], width, height, ch);
-
-            //Compute p
-            p[it] = Func("p_cg_" + itstr + "_" + oitstr  );
-            if( it == 1 )
-            {
-                // p = r
-                p[it](x, y, c) = r_func[it - 1](x, y, c);
-            }
-            else
-            {
-                // p = r + (rho / rho_1)*p;
-                p[it](x, y, c) = r_func[it - 1](x, y, c) + ( rho[it]() / rho[it - 1]() ) * p[it - 1](x, y, c);
-            }
-            
-            //Compute q = Ap
-            //q = Mfun(p);
-            Func AtA_p("AtA_p_cg_" + itstr + "_" + oitstr );
-            AtA_p = AtA_warpHomography(p[it], width, height, H_func, Hinv_func, nhom, MtM_func);
-
-            Func q("q_cg_" + itstr + "_" + oitstr  );
-            q(x, y, c) = beta_cg * AtA_p(x, y, c) + p[it](x, y, c);
-
-
-            
-            //Compute alpha
-            //alpha = rho / (p(:)'*q(:) );
-            Func pq("pq_cg_" + itstr + "_" + oitstr  );
-            pq() = dot_prod(p[it], q, width, height, ch);
-            
-            Func alpha("alpha_cg_" + itstr  + "_" + oitstr );
-            alpha() = rho[it]() / pq();
-            
-            //Compute x
-            //x = x + alpha * p; % update approximation vector
-            x_func[it] = Func("xout_cg_" + itstr + "_" + oitstr );
-            x_func[it](x,y,c) = x_func[it - 1](x,y,c) + alpha() * p[it](x,y,c);
-            
-            //Compute r
-            //r = r - alpha*q;  ; % compute residual
-            r_func[it] = Func("rout_cg_" + itstr + "_" + oitstr );
-            r_func[it](x,y,c) = r_func[it - 1](x,y,c) - alpha() * q(x,y,c);
-            
-            //Schedule r
-            x_func[it].compute_root();
-            r_func[it].compute_root();
-        }
-
-        //Compute the norm of r for final iterate
-        Func norm_r("norm_r");
-        norm_r() = norm_L2(r_func[cgiters], width, height, ch);
-
-        std::vector<Func> outputs;
-        outputs.push_back(x_func[cgiters]); 
-        outputs.push_back(norm_r);     
-        
-        //Compute the norm of r for final iterate
-        //return x_func[cgiters];
-        return outputs;
+////////////////////////////////////////////////////////////////////////////////
+//proximal operator (based on conjugate gradient) for warp + mask
+////////////////////////////////////////////////////////////////////////////////
+
+//Right hand side, same as for the convolution
+// b = beta_cg * AtB + f
+Func CG_warp_rhs(Func xin_func, Func Atb, Expr beta_cg)
+{
+        return CG_conv_rhs(xin_func, Atb, beta_cg);
 }
 
+//Mfun(p) = beta_cg * A^T A p + p, with A = M * W
+auto CG_warp_Mfun(Func H_func, Func Hinv_func, Func MtM_func, Expr width, Expr height,
+        Expr nhom, Expr beta_cg)
+{
+        return [=](Func p) {
+            const int vec_width = 8;
+
+            //Swap x-y axes, same as in warpImg and warpImgT.
+            Func p_swap_axes("p_swap_axes");
+            p_swap_axes(y, x, c) = p(x, y, c);
+
+            Func mask_swap_axes("mask_swap_axes");
+            mask_swap_axes(y, x, c) = MtM_func(x, y, c);
+
+            //Again, swap axes back
+            Func AtA_p("AtA_p");
+            AtA_p(y, x, c) = AtA_warpHomography(p_swap_axes, width, height, H_func, Hinv_func,
+                    nhom, mask_swap_axes)(x, y, c);
+
+            //Schedule, same as in warpImgAtA
+            Var xo;
+            AtA_p.compute_root()
+                .split(x, xo, x, 32)
+                .parallel(xo)
+                .vectorize(y, vec_width);
+
+            Func q("q_cg");
+            q(x, y, c) = beta_cg * AtA_p(x, y, c) + p(x, y, c);
+            return q;
+        };
+}
 
 ////////////////////////////////////////////////////////////////////////////////
 //proximal operator (based on conjugate gradient) for convolution + mask for quadratic ADMM
 ////////////////////////////////////////////////////////////////////////////////
 
-
-//CG with iteration labels
-std::vector<Func>  CG_conv_quadratic(Func xin_func, Func xi_K, Func xi_grad, Func K_func, Func M_func, Func MtM_func, 
-        Expr width, Expr height, Expr ch, Expr width_kernel, Expr height_kernel, 
-        Expr beta_cg, 
-        int cgiters, int outter_iter)
+//Right hand side
+// b = At(xi_K) + beta_cg * Kt(x_grad), with A = M * K
+Func CG_conv_quadratic_rhs(Func xi_K, Func xi_grad, Func K_func, Func M_func,
+        Expr width, Expr height, Expr width_kernel, Expr height_kernel, Expr beta_cg)
 {
-        //Outer iteration number
-        std::string oitstr = std::to_string(outter_iter);
+        Func AtB_xi_K("AtB_xi_K");
+        AtB_xi_K = At_conv(At_M(xi_K, width, height, M_func), width, height, K_func, width_kernel, height_kernel);
 
-        //Compute AtB
-        Func AtB_xi_K("AtB_xi_K" + oitstr);
-        AtB_xi_K = At_conv(xi_K, width, height, K_func, width_kernel, height_kernel, M_func);
-
-        Func AtB_xi_grad("AtB_xi_grad" + oitstr);
+        Func AtB_xi_grad("AtB_xi_grad");
         AtB_xi_grad = KT_grad_mat(xi_grad, width, height);
 
-        //Compute b
-        // b = At(xi_K) + beta_cg * Kt(x_grad)
-        Func b_func("b_cg" + oitstr);
+        Func b_func("b_cg");
         b_func(x, y, c) = AtB_xi_K(x, y, c) + beta_cg * AtB_xi_grad(x, y, c);
 
+        return b_func;
+}
 
-        // Compute residual
-        // r = b - Mfun(x)
-        Func r("r_cg" + oitstr);
-        Func AtA_x("AtA_x_cg" + oitstr);
-        AtA_x = AtA_conv(xin_func, width, height, K_func, width_kernel, height_kernel, MtM_func);
-
-        Func KtK_x("KtK_x_cg" + oitstr);
-        KtK_x = KTK_grad_mat(xin_func, width, height);
+//Mfun(p) = A^T A p + beta_cg * Kt K p
+auto CG_conv_quadratic_Mfun(Func K_func, Func MtM_func, Expr width, Expr height,
+        Expr width_kernel, Expr height_kernel, Expr beta_cg)
+{
+        return [=](Func p) {
+            //AtA_conv is scheduled in tiles, and cannot be inlined.
+            Func AtA_p = AtA_conv(p, width, height, K_func, width_kernel, height_kernel, MtM_func);
+            AtA_p.compute_root();
 
-        Func Mfun_x("Mfun_x_" + oitstr);
-        Mfun_x(x, y, c) = AtA_x(x, y, c) + beta_cg * KtK_x(x, y, c);
+            Func KtK_p = KT_grad_mat(K_grad_mat(p, width, height), width, height);
 
-        r(x, y, c) = b_func(x, y, c) - Mfun_x(x, y, c);
-        
-        //Schedule r
-        r.vectorize(x, 4);
-        Var yo, yi;
-        r.split(y, yo, y, 32).parallel(yo);
-        r.compute_root();
-        
-        ///////////////////////////////////////////////////////////////////
-        // Do iterations
-        ///////////////////////////////////////////////////////////////////
-        
-        //Iterates (iteration plus potentially initial value)
-        Func rho[cgiters + 1];
-        Func p[cgiters + 1];
-        Func r_func[cgiters + 1];
-        Func x_func[cgiters + 1];
-
-        //Intial iterate and residual
-        x_func[0] = xin_func;
-        r_func[0] = r;
-
-        for( int it = 1; it <= cgiters; it++ )
-        {
-            //Output
-            std::string itstr = std::to_string(it);
-            std::cout << "Scheduling iteration [" << it << "/" << cgiters << "]" << std::endl;
-
-            //Compute rho
-            // rho = (r(:)'*r(:));
-            rho[it] = Func( "rho_cg_" + itstr + "_" + oitstr );
-            rho[it]() = dot_prod(r_func[it - 1], r_func[it - 1], width, height, ch);
-
-            //Compute p
-            p[it] = Func("p_cg_" + itstr + "_" + oitstr  );
-            if( it == 1 )
-            {
-                // p = r
-                p[it](x, y, c) = r_func[it - 1](x, y, c);
-            }
-            else
-            {
-                // p = r + (rho / rho_1)*p;
-                p[it](x, y, c) = r_func[it - 1](x, y, c) + ( rho[it]() / rho[it - 1]() ) * p[it - 1](x, y, c);
-            }
-            
-            //Compute q = Ap
-            //q = Mfun(p);
-            Func AtA_p("AtA_p_cg_" + itstr + "_" + oitstr );
-            AtA_p = AtA_conv(p[it], width, height, K_func, width_kernel, height_kernel, MtM_func);
-
-            Func KtK_p("KtK_p_cg" + itstr + "_" + oitstr );
-            KtK_p = KTK_grad_mat(p[it], width, height);
-
-            Func q("q_cg_" + itstr + "_" + oitstr  );
+            Func q("q_cg");
             q(x, y, c) = AtA_p(x, y, c) + beta_cg * KtK_p(x, y, c);
-
-            
-            //Compute alpha
-            //alpha = rho / (p(:)'*q(:) );
-            Func pq("pq_cg_" + itstr + "_" + oitstr  );
-            pq() = dot_prod(p[it], q, width, height, ch);
-            
-            Func alpha("alpha_cg_" + itstr  + "_" + oitstr );
-            alpha() = rho[it]() / pq();
-            
-            //Compute x
-            //x = x + alpha * p; % update approximation vector
-            x_func[it] = Func("xout_cg_" + itstr + "_" + oitstr );
-            x_func[it](x,y,c) = x_func[it - 1](x,y,c) + alpha() * p[it](x,y,c);
-            
-            //Compute r
-            //r = r - alpha*q;  ; % compute residual
-            r_func[it] = Func("rout_cg_" + itstr + "_" + oitstr );
-            r_func[it](x,y,c) = r_func[it - 1](x,y,c) - alpha() * q(x,y,c);
-            
-            //Schedule r
-            x_func[it].compute_root();
-            r_func[it].compute_root();
-        }
-
-        //Compute the norm of r for final iterate
-        Func norm_r("norm_r");
-        norm_r() = norm_L2(r_func[cgiters], width, height, ch);
-
-        std::vector<Func> outputs;
-        outputs.push_back(x_func[cgiters]); 
-        outputs.push_back(norm_r);     
-        
-        //Compute the norm of r for final iterate
-        //return x_func[cgiters];
-        return outputs;
+            return q;
+        };
 }
 
-} // namespace
\ No newline at end of file
+} // namespace
@@ -0,0 +1,178 @@
+////////////////////////////////////////////////////////////////////////////////
+//Deterministic full reductions, e.g. for dot products and norms.
+//
+//The order of the summation depends on the size of the domain only, never on
+//the number of threads, such that the result is bitwise identical on any core
+//count. Each row is summed in vec_width interleaved lanes; the lanes, then the
+//rows, are summed pairwise in blocks of block_size. Remainders of the lanes and
+//of the blocks are padded with zeros, i.e. all rows and columns are counted.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Halide.h"
+
+namespace reduction {
+
+using namespace Halide;
+
+/** Number of interleaved partial sums of each row. Fixed, rather than the
+ * natural vector size of the target, such that the result is also independent
+ * of the instruction set. */
+constexpr int vec_width = 8;
+
+/** Number of rows, or blocks of rows, summed pairwise at a time. */
+constexpr int block_size = 64;
+
+namespace detail {
+
+/** Values of a Func call, as a list of one or more Tuple elements. */
+inline std::vector<Expr>
+values(const FuncRef& f) {
+    if (f.size() == 1) {
+        return {Expr(f)};
+    }
+
+    std::vector<Expr> v(f.size());
+    for (size_t t = 0; t < v.size(); t++) {
+        v[t] = f[t];
+    }
+    return v;
+}
+
+/** Define the Func call with one or more Tuple elements. */
+inline void
+define(FuncRef f, const std::vector<Expr>& v) {
+    if (v.size() == 1) {
+        f = v[0];
+    } else {
+        f = Tuple(v);
+    }
+}
+
+inline std::vector<Expr>
+add(const std::vector<Expr>& a, const std::vector<Expr>& b) {
+    std::vector<Expr> v(a.size());
+    for (size_t t = 0; t < v.size(); t++) {
+        v[t] = a[t] + b[t];
+    }
+    return v;
+}
+
+/** The values if the condition holds; otherwise, zeros. */
+inline std::vector<Expr>
+selectOrZero(const Expr& condition, const std::vector<Expr>& a) {
+    std::vector<Expr> v(a.size());
+    for (size_t t = 0; t < v.size(); t++) {
+        v[t] = select(condition, a[t], make_zero(a[t].type()));
+    }
+    return v;
+}
+
+/** Pairwise summation of the terms, in a fixed order. */
+inline std::vector<Expr>
+pairwise(std::vector<std::vector<Expr>> terms) {
+    while (terms.size() > 1) {
+        std::vector<std::vector<Expr>> next;
+        for (size_t j = 0; j + 1 < terms.size(); j += 2) {
+            next.push_back(add(terms[j], terms[j + 1]));
+        }
+        if (terms.size() % 2 == 1) {
+            next.push_back(terms.back());
+        }
+        terms = std::move(next);
+    }
+    return terms[0];
+}
+
+/** Pairwise sum of f(i, ...) over each block of block_size indices i in
+ * [0, n). The result has ceil(n / block_size) elements. */
+inline Func
+blockSum(const Func& f, const Expr& n, const std::string& name) {
+    Var i{"i"};
+    Func g{name};
+
+    std::vector<std::vector<Expr>> terms(block_size);
+    for (int t = 0; t < block_size; t++) {
+        const Expr index = i * block_size + t;
+        terms[t] = selectOrZero(index < n, values(f(min(index, n - 1), _)));
+    }
+    define(g(i, _), pairwise(terms));
+
+    return g;
+}
+
+}  // namespace detail
+
+/** Sum of term(x, y, ...) over x in [0, width) and y in [0, height), for each
+ * value of the remaining dimensions of term, if any, e.g. the batch of images.
+ *
+ * The term may be a Tuple, to compute several sums in one pass. To reduce over
+ * more dimensions, flatten them into the rows y of the term.
+ *
+ * With schedule = false, e.g. for the auto-scheduler, the intermediate Funcs
+ * are left unscheduled; otherwise, the rows are summed in parallel.
+ */
+inline Func
+sum2D(const Func& term, const Expr& width, const Expr& height, const std::string& name = "sum2D",
+      const bool schedule = true) {
+    using namespace detail;
+
+    Var v{"v"}, row{"row"};
+
+    // Interleaved partial sums of each row, in the order of x.
+    const Expr n_chunks = (width + vec_width - 1) / vec_width;
+    RDom rx(1, max(n_chunks - 1, 0));
+
+    Func lanes{name + "_lanes"};
+    define(lanes(v, row, _), selectOrZero(v < width, values(term(min(v, width - 1), row, _))));
+
+    const Expr xi = v + vec_width * rx;
+    define(lanes(v, row, _), add(values(lanes(v, row, _)),
+                                 selectOrZero(xi < width, values(term(min(xi, width - 1), row, _)))));
+
+    // Pairwise sum of the lanes
+    std::vector<std::vector<Expr>> lane_terms(vec_width);
+    for (int t = 0; t < vec_width; t++) {
+        lane_terms[t] = values(lanes(t, row, _));
+    }
+
+    Func rows{name + "_rows"};
+    define(rows(row, _), pairwise(lane_terms));
+
+    // Pairwise sum of the rows, in blocks of block_size rows, then of the
+    // blocks. Blocks in excess of block_size^2 rows, if any, are summed in
+    // sequence.
+    Func blocks = blockSum(rows, height, name + "_blocks");
+    const Expr n_blocks = (height + block_size - 1) / block_size;
+
+    Func superblocks = blockSum(blocks, n_blocks, name + "_superblocks");
+    const Expr n_superblocks = (n_blocks + block_size - 1) / block_size;
+
+    Func result{name};
+    RDom rs(1, max(n_superblocks - 1, 0));
+    define(result(_), values(superblocks(0, _)));
+    define(result(_), add(values(result(_)), values(superblocks(rs, _))));
+
+    if (schedule) {
+        Var ro{"ro"}, ri{"ri"};
+        rows.compute_root()
+            .split(row, ro, ri, 16, TailStrategy::GuardWithIf)
+            .parallel(ro);
+
+        lanes.compute_at(rows, ri).vectorize(v, vec_width);
+        lanes.update().vectorize(v, vec_width);
+
+        blocks.compute_root();
+        superblocks.compute_root();
+        result.compute_root();
+    }
+
+    return result;
+}
+
+}  // namespace reduction
@@ -0,0 +1,141 @@
+#include <HalideBuffer.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+
+#include "conv_benchmark_spatial.h"
+#include "conv_benchmark_sv.h"
+#include "halide_benchmark.h"
+
+using Halide::Runtime::Buffer;
+using Halide::Tools::benchmark;
+
+namespace {
+
+constexpr int W = 1920;
+constexpr int H = 1080;
+
+/** Grid of n_grid x n_grid kernels over the image. */
+constexpr int n_grid = 3;
+constexpr int n_psf = n_grid * n_grid;
+
+constexpr auto samples = 5;
+constexpr auto iterations = 1;
+
+constexpr int kernel_sizes[] = {7, 15, 31};
+
+Buffer<float>
+randomImage(const int width, const int height, const int seed) {
+    std::mt19937 rng{static_cast<std::mt19937::result_type>(seed)};
+    std::uniform_real_distribution<float> uniform{0.0f, 1.0f};
+
+    Buffer<float> img(width, height, 1);
+    img.for_each_value([&](float& v) { v = uniform(rng); });
+    return img;
+}
+
+/** Gaussian kernels, blurrier towards the corners of the image, as of a lens
+ * with field curvature. */
+Buffer<float>
+fieldDependentKernels(const int size) {
+    Buffer<float> K(size, size, n_psf);
+
+    for (int p = 0; p < n_psf; p++) {
+        const float dx = p % n_grid - (n_grid - 1) * 0.5f;
+        const float dy = p / n_grid - (n_grid - 1) * 0.5f;
+        const float sigma = size / 8.0f * (1.0f + std::sqrt(dx * dx + dy * dy));
+
+        float total = 0.0f;
+        for (int j = 0; j < size; j++) {
+            for (int i = 0; i < size; i++) {
+                const float u = i - size / 2;
+                const float v = j - size / 2;
+                K(i, j, p) = std::exp(-(u * u + v * v) / (2.0f * sigma * sigma));
+                total += K(i, j, p);
+            }
+        }
+
+        for (int j = 0; j < size; j++) {
+            for (int i = 0; i < size; i++) {
+                K(i, j, p) /= total;
+            }
+        }
+    }
+    return K;
+}
+
+/** Bilinear interpolation weights of the grid points, summing up to one at
+ * every pixel. */
+Buffer<float>
+bilinearWeights() {
+    Buffer<float> weights(W, H, n_psf);
+
+    const float spacing_x = (W - 1.0f) / (n_grid - 1);
+    const float spacing_y = (H - 1.0f) / (n_grid - 1);
+
+    weights.for_each_element([&](int x, int y, int p) {
+        const float wx = std::max(0.0f, 1.0f - std::abs(x - p % n_grid * spacing_x) / spacing_x);
+        const float wy = std::max(0.0f, 1.0f - std::abs(y - p / n_grid * spacing_y) / spacing_y);
+        weights(x, y, p) = wx * wy;
+    });
+    return weights;
+}
+
+float
+maxAbsDifference(const Buffer<float>& a, const Buffer<float>& b) {
+    float max_diff = 0.0f;
+    a.for_each_element([&](int x, int y, int c) {
+        max_diff = std::max(max_diff, std::abs(a(x, y, c) - b(x, y, c)));
+    });
+    return max_diff;
+}
+
+}  // namespace
+
+int
+main() {
+    Buffer<float> input = randomImage(W, H, 42);
+    Buffer<float> weights = bilinearWeights();
+
+    std::cout << "Spatially varying convolution of a " << W << "x" << H << " image, " << n_grid
+              << "x" << n_grid << " kernels, throughput in MP/s\n";
+
+    for (const int kernel_size : kernel_sizes) {
+        Buffer<float> K = fieldDependentKernels(kernel_size);
+
+        // One pass of the global-kernel convolution per kernel, on the
+        // weighted image, accumulated to the output.
+        Buffer<float> reference(W, H, 1);
+        Buffer<float> weighted(W, H, 1);
+        Buffer<float> blurred(W, H, 1);
+        const double t_per_kernel = benchmark(samples, iterations, [&]() {
+            reference.fill(0.0f);
+            for (int p = 0; p < n_psf; p++) {
+                weighted.for_each_element(
+                    [&](int x, int y, int c) { weighted(x, y, c) = input(x, y, c) * weights(x, y, p); });
+
+                Buffer<float> K_p = K.cropped(2, p, 1);
+                K_p.set_min(0, 0, 0);
+                conv_benchmark_spatial(weighted.raw_buffer(), K_p.raw_buffer(), blurred.raw_buffer());
+
+                reference.for_each_element(
+                    [&](int x, int y, int c) { reference(x, y, c) += blurred(x, y, c); });
+            }
+        });
+
+        Buffer<float> output(W, H, 1);
+        const double t_single_pass = benchmark(samples, iterations, [&]() {
+            conv_benchmark_sv(input.raw_buffer(), K.raw_buffer(), weights.raw_buffer(),
+                              output.raw_buffer());
+        });
+
+        std::cout << "Kernel " << kernel_size << "x" << kernel_size << ": per-kernel passes "
+                  << double(W) * H / t_per_kernel * 1e-6 << ", single pass "
+                  << double(W) * H / t_single_pass * 1e-6 << " (max error "
+                  << maxAbsDifference(reference, output) << ")\n";
+    }
+
+    return 0;
+}
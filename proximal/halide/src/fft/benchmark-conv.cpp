@@ -0,0 +1,126 @@
+#include <HalideBuffer.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+
+#include "conv_benchmark_monolithic.h"
+#include "conv_benchmark_separable.h"
+#include "conv_benchmark_spatial.h"
+#include "conv_benchmark_tiled.h"
+#include "halide_benchmark.h"
+
+using Halide::Runtime::Buffer;
+using Halide::Tools::benchmark;
+
+namespace {
+
+constexpr auto W = CONV_BENCHMARK_WIDTH;
+constexpr auto H = CONV_BENCHMARK_HEIGHT;
+
+constexpr int tile_size = CONFIG_CONV_FFT_TILE_SIZE;
+constexpr int max_kernel_size = CONFIG_CONV_FFT_MAX_KERNEL_SIZE;
+
+constexpr auto samples = 5;
+constexpr auto iterations = 1;
+
+/** Kernel sizes to compare; all within max_kernel_size of the tiled pipeline. */
+constexpr int kernel_sizes[] = {7, 15, 31};
+
+using conv_t = int (*)(halide_buffer_t*, halide_buffer_t*, halide_buffer_t*);
+
+Buffer<float>
+randomImage(const int width, const int height, const int seed) {
+    std::mt19937 rng{static_cast<std::mt19937::result_type>(seed)};
+    std::uniform_real_distribution<float> uniform{0.0f, 1.0f};
+
+    Buffer<float> img(width, height, 1);
+    img.for_each_value([&](float& v) { v = uniform(rng); });
+    return img;
+}
+
+/** Normalized 1D blur kernel with random weights, of size x 1 x 1, i.e. a
+ * factor of rank 1 for convImgSep. */
+Buffer<float>
+randomFactor(const int size, const int seed) {
+    Buffer<float> factor = randomImage(size, 1, seed);
+
+    float total = 0.0f;
+    factor.for_each_value([&](float v) { total += v; });
+    factor.for_each_value([&](float& v) { v /= total; });
+    return factor;
+}
+
+/** Separable 2D kernel, K(i, j) = Kx(i) * Ky(j). */
+Buffer<float>
+outerProduct(const Buffer<float>& Kx, const Buffer<float>& Ky) {
+    Buffer<float> kernel(Kx.width(), Ky.width(), 1);
+    kernel.for_each_element([&](int i, int j, int) { kernel(i, j, 0) = Kx(i, 0, 0) * Ky(j, 0, 0); });
+    return kernel;
+}
+
+float
+maxAbsDifference(const Buffer<float>& a, const Buffer<float>& b) {
+    float max_diff = 0.0f;
+    a.for_each_element([&](int x, int y, int c) {
+        max_diff = std::max(max_diff, std::abs(a(x, y, c) - b(x, y, c)));
+    });
+    return max_diff;
+}
+
+}  // namespace
+
+int
+main() {
+    Buffer<float> input = randomImage(W, H, 42);
+
+    std::cout << "Convolution of a " << W << "x" << H << " image, throughput in MP/s\n";
+
+    // Number of tiles in the overlap-save FFT, plus the kernel transform.
+    constexpr int S = tile_size - max_kernel_size + 1;
+    const double n_tiles = double((W + S - 1) / S) * ((H + S - 1) / S) + 1;
+
+    for (const int kernel_size : kernel_sizes) {
+        Buffer<float> Kx = randomFactor(kernel_size, kernel_size);
+        Buffer<float> Ky = randomFactor(kernel_size, kernel_size + 1);
+        Buffer<float> kernel = outerProduct(Kx, Ky);
+
+        Buffer<float> reference(W, H, 1);
+        Buffer<float> output(W, H, 1);
+
+        const auto runtime = [&](conv_t conv, Buffer<float>& out) {
+            return benchmark(samples, iterations, [&]() {
+                conv(input.raw_buffer(), kernel.raw_buffer(), out.raw_buffer());
+            });
+        };
+        const auto throughput = [](const double t) { return double(W) * H / t * 1e-6; };
+
+        const double t_spatial = runtime(conv_benchmark_spatial, reference);
+        const double t_monolithic = runtime(conv_benchmark_monolithic, output);
+        const float err_monolithic = maxAbsDifference(reference, output);
+        const double t_tiled = runtime(conv_benchmark_tiled, output);
+        const float err_tiled = maxAbsDifference(reference, output);
+        const double t_separable = benchmark(samples, iterations, [&]() {
+            conv_benchmark_separable(input.raw_buffer(), Kx.raw_buffer(), Ky.raw_buffer(),
+                                     output.raw_buffer());
+        });
+        const float err_separable = maxAbsDifference(reference, output);
+
+        std::cout << "Kernel " << kernel_size << "x" << kernel_size << ": spatial "
+                  << throughput(t_spatial) << ", monolithic FFT " << throughput(t_monolithic)
+                  << " (max error " << err_monolithic << "), overlap-save FFT "
+                  << throughput(t_tiled) << " (max error " << err_tiled << "), separable "
+                  << throughput(t_separable) << " (max error " << err_separable << ")\n";
+
+        // Coefficients of ConvCostModel, in nanoseconds.
+        std::cout << "  cost model: direct_per_tap "
+                  << t_spatial * 1e9 / (double(W) * H * kernel_size * kernel_size)
+                  << ", separable_per_tap "
+                  << t_separable * 1e9 / (double(W) * H * 2 * kernel_size)
+                  << ", fft_per_tile_pixel " << t_tiled * 1e9 / (n_tiles * tile_size * tile_size)
+                  << "\n";
+    }
+
+    return 0;
+}
@@ -0,0 +1,87 @@
+#include <HalideBuffer.h>
+
+#include <cstdint>
+#include <iostream>
+#include <random>
+
+#include "halide_benchmark.h"
+
+#ifndef CONFIG_FFT_BENCHMARK_SIZES
+#error List of FFT sizes must be defined with -DCONFIG_FFT_BENCHMARK_SIZES(X)="X(W, H) ..." in the compile command.
+#endif
+
+#define X(W, H) extern "C" int fft_benchmark_##W##x##H##_argv(void**);
+CONFIG_FFT_BENCHMARK_SIZES(X)
+#undef X
+
+using Halide::Runtime::Buffer;
+using Halide::Tools::benchmark;
+
+namespace {
+
+constexpr auto samples = 10;
+constexpr auto iterations = 10;
+
+/** Number of images in a batch, e.g. channels x frames. */
+constexpr int batch_sizes[] = {1, 2, 4, 8, 16};
+
+/** Skip the batches larger than this number of pixels, about 128MB. */
+constexpr int64_t max_batch_pixels = int64_t(1) << 25;
+
+/** Time the forward FFT of a batch of W x H random images. Returns the
+ * throughput in megapixels per second. */
+double
+fftThroughput(int (*fft)(void**), const int width, const int height, const int n_images = 1) {
+    std::mt19937 rng{42};
+    std::uniform_real_distribution<float> uniform{0.0f, 1.0f};
+
+    Buffer<float> input(width, height, n_images);
+    input.for_each_value([&](float& v) { v = uniform(rng); });
+
+    // Hermitian symmetric output, interleaved real and imaginary parts.
+    Buffer<float> output(2, width, (height + 1) / 2 + 1, n_images);
+
+    int shift = 0;
+    void* args[] = {input.raw_buffer(), &shift, &shift, output.raw_buffer()};
+
+    const double t = benchmark(samples, iterations, [&]() { fft(args); });
+    return double(width) * height * n_images / t * 1e-6;
+}
+
+/** Sweep the batch size, at the image size W x H. */
+void
+batchSweep(int (*fft)(void**), const int width, const int height) {
+    std::cout << width << "x" << height << ":";
+    for (const int n_images : batch_sizes) {
+        if (int64_t(width) * height * n_images > max_batch_pixels) {
+            break;
+        }
+        std::cout << " " << fftThroughput(fft, width, height, n_images);
+    }
+    std::cout << " MP/s\n";
+}
+
+}  // namespace
+
+int
+main() {
+    std::cout << "Forward FFT throughput, real to complex\n";
+
+#define X(W, H)                                                                          \
+    std::cout << W << "x" << H << ": " << fftThroughput(fft_benchmark_##W##x##H##_argv, W, H) \
+              << " MP/s\n";
+    CONFIG_FFT_BENCHMARK_SIZES(X)
+#undef X
+
+    std::cout << "Batched forward FFT throughput, batch size of";
+    for (const int n_images : batch_sizes) {
+        std::cout << " " << n_images;
+    }
+    std::cout << "\n";
+
+#define X(W, H) batchSweep(fft_benchmark_##W##x##H##_argv, W, H);
+    CONFIG_FFT_BENCHMARK_SIZES(X)
+#undef X
+
+    return 0;
+}
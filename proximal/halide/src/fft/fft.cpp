@@ -184,6 +184,49 @@ ComplexFunc dft6(ComplexFunc f, int sign, const string &prefix) {
     return F;
 }
 
+// Compute the DFT of odd size R. The inputs are combined in conjugate pairs
+// x[n], x[R - n], which share the twiddle factors up to the sign of the
+// imaginary part. Used for the radix 3, 5 and 7 butterflies.
+ComplexFunc dft_odd(ComplexFunc f, int R, int sign, const string &prefix) {
+    assert(R % 2 == 1);
+    const int half = R / 2;
+
+    Type type = f.types()[0];
+
+    ComplexFunc F(prefix + "X" + std::to_string(R));
+    F(f.args()) = undef_z(type);
+
+    vector<ComplexFuncRef> x = get_func_refs(f, R);
+    vector<ComplexFuncRef> X = get_func_refs(F, R);
+    vector<ComplexFuncRef> T = get_func_refs(F, 2 * half, true);
+
+    // Sums and differences of the conjugate pairs.
+    ComplexExpr dc = x[0];
+    for (int n = 1; n <= half; n++) {
+        T[n - 1] = x[n] + x[R - n];
+        T[half + n - 1] = x[n] - x[R - n];
+        dc += T[n - 1];
+    }
+    X[0] = dc;
+
+    for (int k = 1; k <= half; k++) {
+        // Real and imaginary parts of the twiddle factors, applied to the sums
+        // and the differences respectively.
+        ComplexExpr even = x[0];
+        ComplexExpr odd;
+        for (int n = 1; n <= half; n++) {
+            const double theta = 2 * M_PI * ((k * n) % R) / R;
+            even += T[n - 1] * Expr(static_cast<float>(std::cos(theta)));
+            odd += T[half + n - 1] * Expr(static_cast<float>(std::sin(theta)));
+        }
+
+        X[k] = even + odd * j * sign;
+        X[R - k] = even - odd * j * sign;
+    }
+
+    return F;
+}
+
 ComplexFunc dft8(ComplexFunc f, int sign, const string &prefix) {
     const float sqrt2_2 = 0.70710678f;
 
@@ -251,11 +294,121 @@ ComplexFunc dftN(ComplexFunc x, int N, int sign, const string &prefix) {
     return X;
 }
 
-ComplexFunc dft1d_c2c(ComplexFunc x, int N, int sign,
-                      const string &prefix) {
+// Map to remember previously computed twiddle factors.
+typedef std::map<int, ComplexFunc> TwiddleFactorSet;
+
+// Parallelize the loop v of the stage s. If the condition is defined, only the
+// specialization of s where the condition holds is parallel, see
+// Fft2dDesc::parallel_if.
+void parallel_if(Stage s, const VarOrRVar &v, const Expr &condition) {
+    if (condition.defined()) {
+        s.specialize(condition).parallel(v);
+    } else {
+        s.parallel(v);
+    }
+}
+
+// Prime factors larger than this are computed with Bluestein's algorithm,
+// rather than the O(N^2) direct DFT.
+const int kMaxDirectDftSize = 64;
+
+vector<int> radix_factor(int N);
+
+ComplexFunc fft_dim1(ComplexFunc x,
+                     const vector<int> &NR,
+                     int sign,
+                     int extent_0,
+                     Expr gain,
+                     bool parallel,
+                     const Expr &parallel_condition,
+                     const string &prefix,
+                     const Target &target,
+                     TwiddleFactorSet *twiddle_cache);
+
+// Compute the DFT of size N on dimension 0 of x with Bluestein's algorithm.
+// This re-expresses the DFT as a circular convolution with a chirp, of a
+// power of two size M >= 2N - 1:
+//
+//   X_k = c_k sum_n (x_n c_n) conj(c_(k - n)),   c_n = e^(sign*pi*i*n^2/N)
+//
+// The convolution is computed with the mixed radix FFT of size M. The
+// dimensions of x are expected in the order of the stages of fft_dim1, i.e.
+// (r, s, n0, ...), where n0 is the vectorized dimension of extent extent_0.
+ComplexFunc dft_bluestein(ComplexFunc x, int N, int sign, int extent_0,
+                          const string &prefix, const Target &target) {
+    vector<Var> args(x.args());
+    Var s(args[1]), n0(args[2]);
+    args.erase(args.begin(), args.begin() + 3);
+
+    int M = 1;
+    while (M < 2 * N - 1) {
+        M *= 2;
+    }
+    const vector<int> RM = radix_factor(M);
+
+    // The chirp. Reduce n^2 modulo 2N in integer arithmetic, to keep the
+    // phase accurate in single precision.
+    Var n("n"), m("m"), unit("unit");
+    ComplexFunc chirp(prefix + "chirp");
+    chirp(n) = expj((sign * kPi * cast<float>((n * n) % (2 * N))) / N);
+
+    // The convolution kernel conj(c_m), for m in (-N, N), wrapped around to
+    // [0, M). Fold the gain of the inverse FFT into its spectrum.
+    ComplexFunc kernel(prefix + "kernel");
+    {
+        Expr m_abs = select(m < N, m, M - m);
+        kernel(unit, m) = select(m < N || m > M - N, conj(chirp(clamp(m_abs, 0, N - 1))),
+                                 ComplexExpr(0.0f, 0.0f));
+    }
+    TwiddleFactorSet kernel_cache;
+    ComplexFunc f_kernel = fft_dim1(kernel, RM, -1, 1, 1.0f / M, false, Expr(),
+                                    prefix + "kernel_", target, &kernel_cache);
+
+    // Zero-pad the chirped input to size M. Transpose dimension 0 to dimension
+    // 1, as expected by fft_dim1.
+    ComplexFunc chirped(prefix + "chirped");
+    chirped(A({n0, m, s}, args)) =
+        select(m < N, x(A({min(m, N - 1), s, n0}, args)) * chirp(min(m, N - 1)),
+               ComplexExpr(0.0f, 0.0f));
+
+    TwiddleFactorSet fwd_cache;
+    ComplexFunc f_chirped = fft_dim1(chirped, RM, -1, extent_0, 1.0f, false, Expr(),
+                                     prefix + "fwd_", target, &fwd_cache);
+
+    ComplexFunc filtered(prefix + "filtered");
+    filtered(A({n0, m, s}, args)) = f_chirped(A({n0, m, s}, args)) * f_kernel(0, m);
+
+    TwiddleFactorSet inv_cache;
+    ComplexFunc conv = fft_dim1(filtered, RM, 1, extent_0, 1.0f, false, Expr(),
+                                prefix + "inv_", target, &inv_cache);
+
+    ComplexFunc X(prefix + "XB");
+    X(A({n, s, n0}, args)) = conv(A({n0, n, s}, args)) * chirp(n);
+
+    // The chirp and the kernel spectrum are shared by all subtransforms.
+    chirp.compute_root();
+    f_kernel.compute_root();
+
+    // Compute the convolution in the region of X requested by the stage of
+    // fft_dim1.
+    f_chirped.compute_at(X, Var::outermost());
+    conv.compute_at(X, Var::outermost());
+
+    return X;
+}
+
+// Compute the DFT of size N on dimension 0 of x. If N is a large prime,
+// extent_0 is the extent of the vectorized dimension 2 of x, see
+// dft_bluestein.
+ComplexFunc dft1d_c2c(ComplexFunc x, int N, int sign, int extent_0,
+                      const string &prefix, const Target &target) {
     switch (N) {
     case 2:
         return dft2(x, prefix);
+    case 3:
+    case 5:
+    case 7:
+        return dft_odd(x, N, sign, prefix);
     case 4:
         return dft4(x, sign, prefix);
     case 6:
@@ -263,13 +416,14 @@ ComplexFunc dft1d_c2c(ComplexFunc x, int N, int sign,
     case 8:
         return dft8(x, sign, prefix);
     default:
+        if (N > kMaxDirectDftSize) {
+            // The name of x is unique to the stage of fft_dim1.
+            return dft_bluestein(x, N, sign, extent_0, x.name() + "_", target);
+        }
         return dftN(x, N, sign, prefix);
     }
 }
 
-// Map to remember previously computed twiddle factors.
-typedef std::map<int, ComplexFunc> TwiddleFactorSet;
-
 // Return a function defining the twiddle factors.
 ComplexFunc twiddle_factors(int N, Expr gain, int sign,
                             const string &prefix,
@@ -298,6 +452,7 @@ ComplexFunc fft_dim1(ComplexFunc x,
                      int extent_0,
                      Expr gain,
                      bool parallel,
+                     const Expr &parallel_condition,
                      const string &prefix,
                      const Target &target,
                      TwiddleFactorSet *twiddle_cache) {
@@ -349,7 +504,7 @@ ComplexFunc fft_dim1(ComplexFunc x,
         vector_width = lcm(vector_width, target.natural_vector_size(v.types()[0]));
 
         // Compute the R point DFT of the subtransform.
-        ComplexFunc V = dft1d_c2c(v, R, sign, prefix);
+        ComplexFunc V = dft1d_c2c(v, R, sign, extent_0, prefix, target);
 
         // Write the subtransform and use it as input to the next
         // pass. Since the pure stage is undef, we explicitly generate the
@@ -370,8 +525,14 @@ ComplexFunc fft_dim1(ComplexFunc x,
         exchange(A({n0, ((s_ / S) * R * S) + (s_ % S) + (r_ * S)}, args)) = V_rs;
         exchange.bound(n1, 0, N);
 
+        // Large radices, i.e. the leftover prime factors, are not unrolled.
+        const bool unroll = R < 10;
+
         if (S > 1) {
-            v.compute_at(exchange, s_).unroll(r);
+            v.compute_at(exchange, s_);
+            if (unroll) {
+                v.unroll(r);
+            }
             v.reorder_storage(n0, r, s);
         } else {
             // On the first stage, the twiddle factors are 1, so we can inline this (no-op).
@@ -392,7 +553,9 @@ ComplexFunc fft_dim1(ComplexFunc x,
             }
         }
 
-        exchange.update().unroll(r_);
+        if (unroll) {
+            exchange.update().unroll(r_);
+        }
         // Remember this stage for scheduling later.
         stages.push_back({exchange, rs});
 
@@ -410,7 +573,7 @@ ComplexFunc fft_dim1(ComplexFunc x,
         .reorder(n0, r_, s_, group)
         .vectorize(n0);
     if (parallel) {
-        x.update().parallel(group);
+        parallel_if(x.update(), group, parallel_condition);
     }
     for (size_t i = 0; i + 1 < stages.size(); i++) {
         Func stage = stages[i].first;
@@ -510,6 +673,7 @@ ComplexFunc fft2d_c2c(ComplexFunc x,
                                  N1,  // extent of dim 0.
                                  1.0f,
                                  desc.parallel,
+                                 desc.parallel_if,
                                  prefix,
                                  target,
                                  &twiddle_cache);
@@ -524,6 +688,7 @@ ComplexFunc fft2d_c2c(ComplexFunc x,
                                N0,  // extent of dim 0
                                desc.gain,
                                desc.parallel,
+                               desc.parallel_if,
                                prefix,
                                target,
                                &twiddle_cache);
@@ -747,6 +912,7 @@ ComplexFunc fft2d_r2c(Func r,
                                 N0 / 2,  // extent of dim 0
                                 1.0f,
                                 false,  // We parallelize unzipped below instead.
+                                Expr(),
                                 prefix,
                                 target,
                                 &twiddle_cache);
@@ -790,6 +956,7 @@ ComplexFunc fft2d_r2c(Func r,
                                 zipped_extent0,
                                 gain,
                                 desc.parallel,
+                                desc.parallel_if,
                                 prefix,
                                 target,
                                 &twiddle_cache);
@@ -853,7 +1020,7 @@ ComplexFunc fft2d_r2c(Func r,
     if (desc.parallel) {
         // Note that this also parallelizes dft1, which is computed inside this loop
         // of unzipped.
-        unzipped.parallel(n0o);
+        parallel_if(unzipped, n0o, desc.parallel_if);
     }
 
     // Schedule the final DFT transpose and unzipping updates.
@@ -960,6 +1127,7 @@ Func fft2d_c2r(ComplexFunc c,
                                      zipped_extent0,
                                      1.0f,
                                      desc.parallel,
+                                     desc.parallel_if,
                                      prefix,
                                      target,
                                      &twiddle_cache);
@@ -1015,6 +1183,7 @@ Func fft2d_c2r(ComplexFunc c,
                        std::min(zip_width, N0 / 2),  // extent of dim 0
                        desc.gain,
                        desc.parallel,
+                       desc.parallel_if,
                        prefix,
                        target,
                        &twiddle_cache);
@@ -1079,7 +1248,7 @@ vector<int> radix_factor(int N) {
     }
 
     // Factor N into factors found in the 'radices' set.
-    static const int radices[] = {8, 6, 4, 2};
+    static const int radices[] = {8, 6, 7, 5, 4, 3, 2};
     vector<int> R;
     for (int r : radices) {
         while (N % r == 0) {
@@ -1088,6 +1257,15 @@ vector<int> radix_factor(int N) {
         }
     }
 
+    // Split the factors left over into primes. Small primes are computed by
+    // the direct DFT, large primes by Bluestein's algorithm.
+    for (int p = 11; p * p <= N; p += 2) {
+        while (N % p == 0) {
+            R.push_back(p);
+            N /= p;
+        }
+    }
+
     // If there are still factors left over, just include them as a radix.
     if (N != 1 || R.empty()) {
         R.push_back(N);
@@ -1119,3 +1297,80 @@ Func fft2d_c2r(ComplexFunc c,
                const Fft2dDesc &desc) {
     return fft2d_c2r(c, radix_factor(N0), radix_factor(N1), target, desc);
 }
+
+namespace {
+
+// Schedule the batched FFT fft: one image per thread if is_large_batch holds;
+// otherwise, fft is expected to parallelize within each transform under the
+// opposite condition, see fft2d_r2c_batch. Only the schedule is specialized,
+// the transform is computed once.
+template<typename FuncType>
+FuncType fft2d_batch_schedule(FuncType fft, const Expr &is_large_batch, int vector_size,
+                              const string &name) {
+    vector<Var> args = fft.args();
+    assert(args.size() > 2 && "The batch must be stacked in dimensions 2 and above.");
+
+    FuncType result(name);
+    result(args) = fft(args);
+
+    // Transform each image at the innermost batch dimension.
+    fft.compute_at(result, args[2]);
+
+    result.vectorize(args[0], vector_size);
+
+    // Large batch: one image per thread.
+    Stage large_batch = result.specialize(is_large_batch);
+    for (size_t i = 2; i < args.size(); i++) {
+        large_batch.parallel(args[i]);
+    }
+
+    return result;
+}
+
+}  // namespace
+
+ComplexFunc fft2d_r2c_batch(Func r,
+                            int N0, int N1,
+                            Expr batch_size,
+                            const Target &target,
+                            const Fft2dDesc &desc,
+                            int min_parallel_batch) {
+    string prefix = desc.name.empty() ? "r2c_batch" : desc.name;
+    const Expr is_large_batch = batch_size >= min_parallel_batch;
+
+    Fft2dDesc fft_desc = desc;
+    fft_desc.parallel = true;
+    fft_desc.parallel_if = !is_large_batch;
+    fft_desc.name = prefix + "_fft";
+
+    ComplexFunc fft = fft2d_r2c(r, N0, N1, target, fft_desc);
+
+    const int vector_size = gcd(target.natural_vector_size<float>(), N0);
+    ComplexFunc result = fft2d_batch_schedule(fft, is_large_batch, vector_size, prefix);
+    result.bound(result.args()[0], 0, N0);
+    result.bound(result.args()[1], 0, (N1 + 1) / 2 + 1);
+    return result;
+}
+
+Func fft2d_c2r_batch(ComplexFunc c,
+                     int N0, int N1,
+                     Expr batch_size,
+                     const Target &target,
+                     const Fft2dDesc &desc,
+                     int min_parallel_batch) {
+    string prefix = desc.name.empty() ? "c2r_batch" : desc.name;
+    const Expr is_large_batch = batch_size >= min_parallel_batch;
+
+    Fft2dDesc fft_desc = desc;
+    fft_desc.parallel = true;
+    fft_desc.parallel_if = !is_large_batch;
+    fft_desc.name = prefix + "_fft";
+
+    Func fft = fft2d_c2r(c, N0, N1, target, fft_desc);
+
+    const int vector_size = gcd(target.natural_vector_size<float>(), N0);
+    Func result = fft2d_batch_schedule(fft, is_large_batch, vector_size, prefix);
+    result.bound(result.args()[0], 0, N0);
+    result.bound(result.args()[1], 0, N1);
+    return result;
+}
@@ -30,6 +30,11 @@ struct Fft2dDesc {
     // if there is no outer loop around FFTs that can be parallelized.
     bool parallel = false;
 
+    // If defined, the FFT is parallel only where this condition holds, e.g. a
+    // condition on the batch size. The schedule is specialized on the
+    // condition; the transform is computed once either way.
+    Halide::Expr parallel_if;
+
     // This option will schedule the input to the FFT at the innermost location
     // that makes sense.
     bool schedule_input = false;
@@ -46,6 +51,10 @@ struct Fft2dDesc {
 //
 //   X = fft2d_c2c(x, N0, N1, -1);
 //   x = fft2d_c2c(X, N0, N1, 1) / (N0 * N1);
+//
+// N0 and N1 need not be powers of two. The sizes are factored into radix 2 to
+// 8 butterflies; the prime factors left over are computed by a direct DFT if
+// small, or by Bluestein's algorithm otherwise, e.g. N = 1366 = 2 x 683.
 ComplexFunc fft2d_c2c(ComplexFunc x, int N0, int N1, int sign,
                       const Halide::Target &target,
                       const Fft2dDesc &desc = Fft2dDesc());
@@ -66,4 +75,26 @@ Halide::Func fft2d_c2r(ComplexFunc c, int N0, int N1,
                        const Halide::Target &target,
                        const Fft2dDesc &desc = Fft2dDesc());
 
+// Batched versions of fft2d_r2c and fft2d_c2r, for a stack of images in
+// dimensions 2 and above of the input, e.g. channels x frames. batch_size is
+// the total number of images, which may be determined at run time. If
+// batch_size >= min_parallel_batch, the images are transformed in parallel,
+// one image per thread; otherwise, each transform is parallelized internally.
+// desc.parallel and desc.parallel_if are ignored. Only the schedule depends on
+// the batch size, i.e. each image is transformed once.
+//
+// The result is scheduled by these functions; the caller only needs to
+// decide where to compute it, e.g. compute_root().
+ComplexFunc fft2d_r2c_batch(Halide::Func r, int N0, int N1,
+                            Halide::Expr batch_size,
+                            const Halide::Target &target,
+                            const Fft2dDesc &desc = Fft2dDesc(),
+                            int min_parallel_batch = 8);
+
+Halide::Func fft2d_c2r_batch(ComplexFunc c, int N0, int N1,
+                             Halide::Expr batch_size,
+                             const Halide::Target &target,
+                             const Fft2dDesc &desc = Fft2dDesc(),
+                             int min_parallel_batch = 8);
+
 #endif
@@ -15,15 +15,16 @@ Var x("x"), y("y"), c("c"), k("k");
 
 #include "fft/fft.h"
 
-Func fft2_r2c(Func input, int W, int H, const Target& target) {
+Func fft2_r2c(Func input, int W, int H, Expr batch_size, const Target& target) {
 
     //Local vars
     Var h("h"), l("l"), m("m"); 
 
     Fft2dDesc fwd_desc;
 
-    // Compute the DFT of the input and the kernel.
-    ComplexFunc dft_in = fft2d_r2c(input, W, H, target, fwd_desc);
+    // Compute the DFT of the input and the kernel. Parallelize across the
+    // channels if there are many, otherwise within each transform.
+    ComplexFunc dft_in = fft2d_r2c_batch(input, W, H, batch_size, target, fwd_desc);
     dft_in.compute_root();
   
     // Pure definition: do nothing.
@@ -65,7 +66,7 @@ public:
         Func input_func("in");
         input_func(x, y, c) = paddedInput( x + shiftx, y + shifty, c );
 
-        const auto transformed = fft2_r2c(input_func, (int)wtarget, (int)htarget, get_target());
+        const auto transformed = fft2_r2c(input_func, (int)wtarget, (int)htarget, input.dim(2).extent(), get_target());
 
         // Crop the FFT transformed signal by the user-defined output dimensions.
         fftIn(k, x, y, c) = transformed(k, x, y, c);
@@ -12,7 +12,7 @@ namespace {
 Var x("x"), y("y"), c("c"), k("k");
 
 //Convolution
-Func ifft2_c2r(Func input, int W, int H, const Target& target) {
+Func ifft2_c2r(Func input, int W, int H, Expr batch_size, const Target& target) {
 
     Fft2dDesc inv_desc;
     inv_desc.gain = 1.0f/(W*H);
@@ -21,8 +21,9 @@ Func ifft2_c2r(Func input, int W, int H, const Target& target) {
     ComplexFunc input_complex;
     input_complex(x, y, c) = {input(0, x, y, c), input(1, x, y, c)};
 
-    // Compute the inverse DFT
-    Func res = fft2d_c2r(input_complex, W, H, target, inv_desc);
+    // Compute the inverse DFT. Parallelize across the channels if there are
+    // many, otherwise within each transform.
+    Func res = fft2d_c2r_batch(input_complex, W, H, batch_size, target, inv_desc);
     res.compute_root();
 
     return res;
@@ -36,11 +37,11 @@ public:
     Input<Buffer<float, 4>> input{"input"};
     Output<Buffer<float, 3>> fftOut{"output"};
 
-    GeneratorParam<int> wtarget{"wtarget", 512, 2, 1024};
-    GeneratorParam<int> htarget{"htarget", 512, 2, 1024};
+    GeneratorParam<int> wtarget{"wtarget", 512, 2, 4096};
+    GeneratorParam<int> htarget{"htarget", 512, 2, 4096};
     
     void generate() {
-        const auto transformed = ifft2_c2r(input, (int)wtarget, (int)htarget, get_target());
+        const auto transformed = ifft2_c2r(input, (int)wtarget, (int)htarget, input.dim(3).extent(), get_target());
 
         // Crop the image by the user-defined dimensions
         fftOut(x, y, c) = transformed(x, y, c);
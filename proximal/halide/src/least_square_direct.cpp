@@ -19,12 +19,19 @@ class least_square_direct_gen : public Generator<least_square_direct_gen> {
     Input<float> rho{"rho"};
     Input<Buffer<float, 3>> offset{"offset"};
     Input<Buffer<float, 4>> freq_diag{"freq_diag"};
-    Input<uint64_t> input_hash{"offset_hash"};
+
+    /** Fourier-transformed input, cached by the caller. Read if is_cached is
+     * true; otherwise, the input is transformed and exported to
+     * output_spectrum, for the caller to cache. On a cache hit, the caller
+     * passes an output_spectrum of zero channels, to skip the export. */
+    Input<Buffer<float, 4>> input_spectrum{"input_spectrum"};
+    Input<bool> is_cached{"is_cached"};
 
     Output<Buffer<float, 3>> output{"output"};
+    Output<Buffer<float, 4>> output_spectrum{"output_spectrum"};
 
-    GeneratorParam<int> wtarget{"wtarget", 512, 2, 1024};
-    GeneratorParam<int> htarget{"htarget", 512, 2, 1024};
+    GeneratorParam<int> wtarget{"wtarget", 512, 2, 4096};
+    GeneratorParam<int> htarget{"htarget", 512, 2, 4096};
     GeneratorParam<bool> ignore_offset{"ignore_offset", false};
 
     void generate() {
@@ -48,10 +55,13 @@ class least_square_direct_gen : public Generator<least_square_direct_gen> {
         f_input_tmp = fft2d_r2c(shifted_input, W, H, target, fwd_desc);
 
         f_input_cached(x, y, k, c) =
-            memoize_tag(mux(k, {f_input_tmp(x, y, c).re(), f_input_tmp(x, y, c).im()}), input_hash);
+            select(is_cached, input_spectrum(k, x, y, c),
+                   mux(k, {f_input_tmp(x, y, c).re(), f_input_tmp(x, y, c).im()}));
         f_input(x, y, c) = {f_input_cached(x, y, RE, c), f_input_cached(x, y, IM, c)};
+        output_spectrum(k, x, y, c) = f_input_cached(x, y, k, c);
 
-        f_offset = fft2d_r2c(padded_offset, W, H, target, fwd_desc);
+        const Expr n_channels = input.dim(2).extent();
+        f_offset = fft2d_r2c_batch(padded_offset, W, H, n_channels, target);
 
         // Cast freq_diag from pair<float> to std:::complex<float>
         diag(x, y, c) = {freq_diag(RE, x, y, c), freq_diag(IM, x, y, c)};
@@ -67,9 +77,8 @@ class least_square_direct_gen : public Generator<least_square_direct_gen> {
         // Inverse DFT
         Fft2dDesc inv_desc{};
         inv_desc.gain = 1.0f / (W * H);
-        inv_desc.parallel = true;
 
-        inversed = fft2d_c2r(weighted_average, W, H, target, inv_desc);
+        inversed = fft2d_c2r_batch(weighted_average, W, H, n_channels, target, inv_desc);
         output = inversed;
     }
 
@@ -79,12 +88,21 @@ class least_square_direct_gen : public Generator<least_square_direct_gen> {
         offset.dim(2).set_extent(n_channels);
         freq_diag.dim(3).set_extent(n_channels);
         output.dim(2).set_extent(n_channels);
+        input_spectrum.dim(3).set_extent(n_channels);
 
         // Frequency domain diagonals size must match FFT target size
         freq_diag.dim(0).set_extent(2);
         freq_diag.dim(1).set_extent(wtarget);
         //freq_diag.dim(2).set_extent(htarget);
 
+        // The spectra are Hermitian symmetric, see fft2d_r2c.
+        for (auto* a : {&input_spectrum, &output_spectrum}) {
+            a->dim(0).set_bounds(0, 2);
+            a->dim(1).set_bounds(0, wtarget);
+            a->dim(2).set_bounds(0, (htarget + 1) / 2 + 1);
+            a->dim(3).set_min(0);
+        }
+
         // All buffers must start with index zero
         input.dim(0).set_min(0);
         offset.dim(0).set_min(0);
@@ -116,9 +134,9 @@ class least_square_direct_gen : public Generator<least_square_direct_gen> {
         .parallel(c)
         ;
 
-        inversed //
-            .compute_root()
-            .parallel(c);
+        // Parallelized across the channels, or within each transform, see
+        // fft2d_c2r_batch.
+        inversed.compute_root();
 
         weighted_average //
             .compute_root()
@@ -127,9 +145,7 @@ class least_square_direct_gen : public Generator<least_square_direct_gen> {
             .parallel(c);
 
         if(!ignore_offset) {
-            f_offset
-                .compute_root()  //
-                .parallel(c);
+            f_offset.compute_root();
 
             padded_offset
                 .compute_root()  //
@@ -138,7 +154,7 @@ class least_square_direct_gen : public Generator<least_square_direct_gen> {
                 .parallel(c);
         }
 
-        // Cache the Fourier-transformed input
+        // Read the Fourier-transformed input from the cache, if available.
         f_input_cached  //
             .compute_root()
             .bound(k, 0, 2)
@@ -146,16 +162,21 @@ class least_square_direct_gen : public Generator<least_square_direct_gen> {
             .vectorize(x, vfloat)
             .parallel(y)
             .parallel(c)
-            .memoize();
+            .specialize(is_cached);
 
-        // Compute FFT only when cache is evicted
+        output_spectrum  //
+            .bound(k, 0, 2)
+            .unroll(k)
+            .vectorize(x, vfloat)
+            .parallel(y);
+
+        // Compute FFT only on cache miss
         f_input_tmp.compute_at(f_input_cached, c);
 
         shifted_input
-            .compute_at(f_input_cached, Var::outermost())  //
+            .compute_at(f_input_cached, c)  //
             .vectorize(x, vfloat)
-            .parallel(y)
-            .parallel(c);
+            .parallel(y);
     }
 
    private:
@@ -0,0 +1,219 @@
+#include <Halide.h>
+using namespace Halide;
+
+#include <optional>
+
+#include "admm.h"
+#include "least-squares.h"
+#include "linearized-admm.h"
+#include "problem-definition.h"
+
+/** Halide-optimized ADMM iterations for the problem in problem_definition.
+ *
+ * The v-update is solved exactly in the frequency domain, see
+ * algorithm::least_squares::FrequencyDomainInverse . This requires omega_fn to
+ * be a sum of squares, i.e. omega(v) = alpha || v - b ||^2, and K^T K to be
+ * shift invariant, with the boundary condition of K: the image gradient of
+ * problem_definition::K mirrors the image at the borders.
+ *
+ * The variables z_i, u_i are created in configure(), one per function in
+ * psi_fns. The generated pipeline takes the arguments in the following order:
+ *
+ *     input, lmb, z0 ... z{N-1}, u0 ... u{N-1},
+ *     v_new, r, s, eps_pri, eps_dual, z0_new ... z{N-1}_new, u0_new ... u{N-1}_new
+ */
+class ADMMIter : public Generator<ADMMIter> {
+    static constexpr auto W = problem_config::output_width;
+    static constexpr auto H = problem_config::output_height;
+    static constexpr auto N = problem_config::psi_size;
+
+    using InputBuffers = std::array<Input<Buffer<float>>*, N>;
+    using OutputBuffers = std::array<Output<Buffer<float>>*, N>;
+
+   public:
+    /** User-provided distorted, and noisy images.
+     *
+     * The third dimension indexes the images in a batch. Each image is solved
+     * independently, with its own convergence metrics.
+     */
+    Input<Buffer<float, 3>> input{"input"};
+
+    /** Problem scaling factor.
+     *
+     * Unlike the linearized ADMM, the algorithm converges for any lmb > 0.
+     */
+    Input<float> lmb{"lmb", 1.0f, 1e-5f, 1e5f};
+
+    /** Number of ADMM iterations before computing convergence metrics. */
+    GeneratorParam<uint32_t> n_iter{"n_iter", 1ul, 1ul, 500ul};
+
+    /** Optimal solution, after a hard termination after iterating for n_iter
+     * times. */
+    Output<Buffer<float, 3>> v_new{"v_new"};
+
+    // Convergence metrics, one per image in the batch.
+    Output<Buffer<float, 1>> r{"r"};  //!< Primal residual
+    Output<Buffer<float, 1>> s{"s"};  //!< Dual residual
+    Output<Buffer<float, 1>> eps_pri{"eps_pri"};
+    Output<Buffer<float, 1>> eps_dual{"eps_dual"};
+
+    // Split variables z_i, and scaled dual variables u_i, one per psi_fns.
+    InputBuffers z{};
+    InputBuffers u{};
+    OutputBuffers z_new{};
+    OutputBuffers u_new{};
+
+    void configure() {
+        using problem_definition::psi_fns;
+
+        for (size_t i = 0; i < N; i++) {
+            user_assert(psi_fns[i].n_dim == problem_config::psi_n_dim[i])
+                << "problem_config::psi_n_dim does not match psi_fns.";
+
+            const auto n_dim = psi_fns[i].n_dim;
+            const auto index = std::to_string(i);
+            z[i] = add_input<Buffer<float>>("z" + index, n_dim);
+            u[i] = add_input<Buffer<float>>("u" + index, n_dim);
+            z_new[i] = add_output<Buffer<float>>("z" + index + "_new", n_dim);
+            u_new[i] = add_output<Buffer<float>>("u" + index + "_new", n_dim);
+        }
+    }
+
+    void generate() {
+        using problem_definition::K;
+        using problem_definition::omega_fn;
+        using problem_definition::psi_fns;
+
+        user_assert(omega_fn.beta == 1.0f && omega_fn.gamma == 0.0f && omega_fn._c == 0.0f &&
+                    omega_fn.d == 0.0f)
+            << "The frequency domain inverse requires omega_fn = alpha || v - b ||^2 .";
+
+        v_list.resize(n_iter);
+        z_list.resize(n_iter);
+        u_list.resize(n_iter);
+
+        // Forward product K v of the last iteration, re-used by the convergence check.
+        FuncTuple<N> Kv;
+
+        const Expr input_size = W * H;
+        const Expr output_size = W * H;
+
+        // Reduce over each image, but not across the batch.
+        const RDom output_dimensions{0, W, 0, H, 0, problem_config::psi_k_extent};
+
+        // The offset b in omega_fn is the input image.
+        least_squares.emplace(K, input, omega_fn.alpha, target,
+                              algorithm::least_squares::Boundary::neumann);
+
+        for (size_t i = 0; i < n_iter; i++) {
+            const FuncTuple<N>& z_prev = (i == 0) ? toFuncTuple(z) : z_list[i - 1];
+            const FuncTuple<N>& u_prev = (i == 0) ? toFuncTuple(u) : u_list[i - 1];
+
+            std::tie(v_list[i], z_list[i], u_list[i], Kv) =
+                algorithm::admm::iterate(z_prev, u_prev, K, *least_squares, psi_fns, lmb);
+        }
+
+        // The dual residual is of the same form as that of the linearized ADMM.
+        const auto& z_prev = (n_iter > 1) ? *(z_list.rbegin() + 1) : toFuncTuple(z);
+        const auto [_r, _s, _eps_pri, _eps_dual] = algorithm::linearized_admm::computeConvergence(
+            Kv, z_list.back(), u_list.back(), z_prev, K, lmb, input_size, output_size,
+            output_dimensions);
+
+        // Export data
+        v_new = v_list.back();
+        for (size_t i = 0; i < N; i++) {
+            *z_new[i] = z_list.back()[i];
+            *u_new[i] = u_list.back()[i];
+        }
+        r(c) = _r;
+        s(c) = _s;
+        eps_pri(c) = _eps_pri;
+        eps_dual(c) = _eps_dual;
+    }
+
+    /** Inform Halide of the input and output image sizes.
+     *
+     * The batch size is determined at run time. All buffers must hold the same
+     * number of images.
+     */
+    void setBounds() {
+        input.dim(0).set_bounds(0, W);
+        input.dim(1).set_bounds(0, H);
+        input.dim(2).set_min(0);
+
+        const Expr batch_size = input.dim(2).extent();
+
+        const auto setImageBounds = [&](auto* a) {
+            a->dim(0).set_bounds(0, W);
+            a->dim(1).set_bounds(0, H);
+            a->dim(2).set_bounds(0, batch_size);
+
+            if (a->dimensions() == 4) {
+                a->dim(3).set_bounds(0, problem_config::psi_k_extent);
+            }
+        };
+
+        setImageBounds(&v_new);
+        for (size_t i = 0; i < N; i++) {
+            setImageBounds(z[i]);
+            setImageBounds(u[i]);
+            setImageBounds(z_new[i]);
+            setImageBounds(u_new[i]);
+        }
+
+        for (auto* a : {&r, &s, &eps_pri, &eps_dual}) {
+            a->dim(0).set_bounds(0, batch_size);
+        }
+    }
+
+    void schedule() {
+        assert(!using_autoscheduler() && "Auto-scheduler not possible with manual schedules in FFT");
+
+        setBounds();
+
+        const auto vec_width = natural_vector_size<float>();
+
+        least_squares->schedule();
+
+        // The FFT reads the whole image. Store the intermediate results.
+        for (size_t i = 0; i + 1 < n_iter; i++) {
+            for (auto& f : z_list[i]) {
+                f.compute_root().vectorize(x, vec_width).parallel(y);
+            }
+            for (auto& f : u_list[i]) {
+                f.compute_root().vectorize(x, vec_width).parallel(y);
+            }
+        }
+
+        // Images in a batch are independent; iterate over them in the outermost loop.
+        for (size_t i = 0; i < N; i++) {
+            for (auto* a : {z_new[i], u_new[i]}) {
+                if (a->dimensions() == 4) {
+                    a->reorder(k, x, y, c)
+                        .vectorize(x, vec_width)
+                        .parallel(y)
+                        .unroll(k, problem_config::psi_k_extent);
+                } else {
+                    a->reorder(x, y, c).vectorize(x, vec_width).parallel(y);
+                }
+            }
+        }
+    }
+
+   private:
+    std::vector<Func> v_list;
+    std::vector<FuncTuple<N>> z_list;
+    std::vector<FuncTuple<N>> u_list;
+
+    std::optional<algorithm::least_squares::FrequencyDomainInverse<W, H>> least_squares;
+
+    static FuncTuple<N> toFuncTuple(const InputBuffers& buffers) {
+        FuncTuple<N> funcs;
+        for (size_t i = 0; i < N; i++) {
+            funcs[i] = *buffers[i];
+        }
+        return funcs;
+    }
+};
+
+HALIDE_REGISTER_GENERATOR(ADMMIter, admm_iter);
@@ -0,0 +1,104 @@
+#include "admm-runtime.h"
+
+#include <HalideBuffer.h>
+
+#include <cassert>
+#include <chrono>
+#include <vector>
+
+#include "admm_iter.h"
+#include "pipeline-args.h"
+#include "problem-config.h"
+
+using Halide::Runtime::Buffer;
+
+namespace proximal {
+namespace runtime {
+
+constexpr auto W = problem_config::input_width;
+constexpr auto H = problem_config::input_height;
+
+signals_t
+admmSolver(Buffer<const float>& input, const size_t iter_max, float lmb) {
+    assert(input.dim(0).extent() == W);
+    assert(input.dim(1).extent() == H);
+    const auto start = std::chrono::steady_clock::now();
+
+    // Batch of one image.
+    Buffer<float> v_new(W, H, 1);
+
+    // One z_i, u_i per psi_fns, either 3D or 4D.
+    std::vector<Buffer<float>> z;
+    std::vector<Buffer<float>> u;
+    std::vector<Buffer<float>> z_new;
+    std::vector<Buffer<float>> u_new;
+    for (const int n_dim : problem_config::psi_n_dim) {
+        const auto shape = (n_dim == 4) ? std::vector<int>{W, H, 1, problem_config::psi_k_extent}
+                                        : std::vector<int>{W, H, 1};
+
+        for (auto* p : {&z, &u, &z_new, &u_new}) {
+            p->emplace_back(shape);
+        }
+    }
+
+    // Set zeros
+    for (auto* p : {&z, &u}) {
+        for (auto& buf : *p) {
+            buf.fill(0.0f);
+            buf.set_host_dirty();
+        }
+    }
+
+    std::vector<float> r(iter_max);
+    std::vector<float> s(iter_max);
+    std::vector<float> eps_pri(iter_max);
+    std::vector<float> eps_dual(iter_max);
+
+    for (size_t i = 0; i < iter_max; i++) {
+        Buffer<float> _r(r.data() + i, 1);
+        Buffer<float> _s(s.data() + i, 1);
+        Buffer<float> _eps_pri(eps_pri.data() + i, 1);
+        Buffer<float> _eps_dual(eps_dual.data() + i, 1);
+
+        PipelineArgs args;
+        args << input << lmb << z << u << v_new << _r << _s << _eps_pri << _eps_dual << z_new
+             << u_new;
+
+        const auto error = args.call(admm_iter_argv);
+
+        if (error) {
+            return {error, {}, {}, {}, {}, {}};
+        }
+
+        // Terminate the algorithm early, if optimal solution is reached.
+        for (auto* p : {&_r, &_s, &_eps_pri, &_eps_dual}) {
+            p->copy_to_host();
+        }
+
+        const bool converged = (r[i] < eps_pri[i]) && (s[i] < eps_dual[i]);
+        if (converged) {
+            for (auto* v : {&r, &s, &eps_pri, &eps_dual}) {
+                v->resize(i + 1);
+            }
+            break;
+        }
+
+        if (i != iter_max - 1) {
+            // This iteration's z_new, u_new become current z, u in the next
+            // iteration. The v-update does not depend on the previous v.
+            std::swap(u, u_new);
+            std::swap(z, z_new);
+        }
+    }
+
+    v_new.copy_to_host();
+
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    constexpr int success = 0;
+    return {success, v_new, r, s, eps_pri, eps_dual, r.size(), elapsed.count()};
+}
+
+}  // namespace runtime
+
+}  // namespace proximal
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <HalideBuffer.h>
+
+#include "signals.h"
+
+namespace proximal {
+namespace runtime {
+
+/** Runtime function to call ADMM, with early termination.
+ *
+ * Same as ladmmSolver(), except that the Halide-optimized AOT pipeline solves
+ * the v-update exactly with the frequency domain inverse. This takes fewer
+ * iterations to converge than the linearized ADMM, at the cost of two FFTs per
+ * iteration.
+ *
+ * The tolerances eps_abs = eps_rel = 1e-3 of the convergence criteria are
+ * compiled into the pipeline. Only the image size defined in problem_config is
+ * supported.
+ */
+signals_t admmSolver(Buffer<const float>& input, const size_t iter_max = 100,
+                     float lmb = 1.0f);
+
+}  // namespace runtime
+
+}  // namespace proximal
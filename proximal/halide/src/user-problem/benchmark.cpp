@@ -0,0 +1,140 @@
+#include <HalideBuffer.h>
+
+#include <iostream>
+#include <random>
+
+#include "halide_benchmark.h"
+#include "ladmm-runtime.h"
+#include "problem-config.h"
+
+using Halide::Runtime::Buffer;
+using Halide::Tools::benchmark;
+using proximal::runtime::Acceleration;
+using proximal::runtime::LadmmWorkspace;
+using proximal::runtime::ladmmSolver;
+using proximal::runtime::ladmmSolverBatch;
+using proximal::runtime::ladmmSolverWarmStart;
+
+namespace {
+
+constexpr auto W = problem_config::input_width;
+constexpr auto H = problem_config::input_height;
+
+constexpr auto samples = 10;
+constexpr auto iterations = 10;
+
+constexpr auto batch_size = 8;
+
+constexpr auto n_frames = 8;
+
+/** Synthetic noisy images, so that the benchmark does not depend on the image I/O libraries.
+ *
+ * Image #c is shifted horizontally by c * shift pixels, emulating the frames
+ * of a panning video.
+ */
+Buffer<float>
+noisyImage(const int n_images = 1, const int shift = 0) {
+    std::mt19937 rng{42};
+    std::normal_distribution<float> noise{0.0f, 0.1f};
+
+    Buffer<float> img(W, H, n_images);
+    img.for_each_element([&](int x, int y, int c) {
+        const float checkerboard = (((x + c * shift) / 32 + y / 32) % 2 == 0) ? 0.25f : 0.75f;
+        img(x, y, c) = checkerboard + noise(rng);
+    });
+    return img;
+}
+
+}  // namespace
+
+int
+main() {
+    Buffer<const float> input = noisyImage();
+
+    constexpr size_t n_iter = 10;
+
+    size_t n_iter_alloc = 0;
+    const double t_alloc = benchmark(samples, iterations, [&]() {
+        n_iter_alloc = ladmmSolver(input, n_iter).n_iter;
+    });
+
+    LadmmWorkspace workspace{n_iter};
+    size_t n_iter_reuse = 0;
+    const double t_reuse = benchmark(samples, iterations, [&]() {
+        n_iter_reuse = ladmmSolver(input, workspace, n_iter).n_iter;
+    });
+
+    // The tolerances are compiled into the pipeline, so the solver may
+    // converge before n_iter. Both cases must do the same amount of work.
+    if (n_iter_alloc != n_iter_reuse) {
+        std::cerr << "Iterations differ, allocating buffers: " << n_iter_alloc
+                  << ", re-using workspace: " << n_iter_reuse << '\n';
+        return 1;
+    }
+
+    std::cout << "L-ADMM " << W << "x" << H << ", " << n_iter_reuse << " iterations per call\n"
+              << "Per-call latency, allocating buffers: " << t_alloc * 1e3 << " ms\n"
+              << "Per-call latency, re-using workspace: " << t_reuse * 1e3 << " ms\n";
+
+    // Denoise a burst of images, one-by-one versus in a single batch.
+    Buffer<const float> burst = noisyImage(batch_size);
+
+    const double t_serial = benchmark(samples, 1, [&]() {
+        for (int n = 0; n < batch_size; n++) {
+            Buffer<const float> frame = burst.sliced(2, n).embedded(2, 0);
+            ladmmSolver(frame, workspace, n_iter);
+        }
+    });
+
+    LadmmWorkspace batch_workspace{n_iter, batch_size};
+    const double t_batch = benchmark(samples, 1, [&]() {
+        ladmmSolverBatch(burst, batch_workspace, n_iter);
+    });
+
+    std::cout << "Burst of " << batch_size << " images, serial: " << t_serial * 1e3 << " ms\n"
+              << "Burst of " << batch_size << " images, batched: " << t_batch * 1e3 << " ms\n";
+
+    // Denoise a video, where each frame is the previous one shifted by one
+    // pixel. Warm-start from the previous frame's solution.
+    Buffer<const float> video = noisyImage(n_frames, 1);
+
+    size_t n_iter_cold = 0;
+    size_t n_iter_warm = 0;
+    double t_cold = 0.0;
+    double t_warm = 0.0;
+    for (int n = 0; n < n_frames; n++) {
+        Buffer<const float> frame = video.sliced(2, n).embedded(2, 0);
+
+        const auto cold = ladmmSolver(frame, workspace);
+        n_iter_cold += cold.n_iter;
+        t_cold += cold.elapsed;
+    }
+
+    workspace.reset();
+    for (int n = 0; n < n_frames; n++) {
+        Buffer<const float> frame = video.sliced(2, n).embedded(2, 0);
+
+        const auto warm = ladmmSolverWarmStart(frame, workspace);
+        n_iter_warm += warm.n_iter;
+        t_warm += warm.elapsed;
+    }
+
+    std::cout << "Video of " << n_frames << " shifted frames, cold start: " << n_iter_cold
+              << " iterations, " << t_cold * 1e3 << " ms\n"
+              << "Video of " << n_frames << " shifted frames, warm start: " << n_iter_warm
+              << " iterations, " << t_warm * 1e3 << " ms\n";
+
+    // Compare the update policies, in the slow tail of convergence.
+    for (const auto& [acceleration, name] :
+         {std::make_pair(Acceleration::none, "plain"),
+          std::make_pair(Acceleration::over_relaxation, "over-relaxed"),
+          std::make_pair(Acceleration::momentum, "accelerated")}) {
+        workspace.acceleration = acceleration;
+        const auto result = ladmmSolver(input, workspace, 500);
+
+        std::cout << "Update policy " << name << ": " << result.n_iter << " iterations, "
+                  << result.elapsed * 1e3 << " ms\n";
+    }
+
+    return 0;
+}
@@ -0,0 +1,202 @@
+#include <Halide.h>
+using namespace Halide;
+
+#include <optional>
+
+#include "half-quadratic-splitting.h"
+#include "least-squares.h"
+#include "problem-definition.h"
+
+/** Halide-optimized half-quadratic splitting (HQS) iterations for the problem
+ * in problem_definition.
+ *
+ * The pipeline runs n_iter inner iterations at a fixed penalty rho; the
+ * runtime increases rho between the calls. The omega step is solved in the
+ * frequency domain, see algorithm::least_squares::FrequencyDomainInverse .
+ *
+ * The variables w_i are created in configure(), one per function in psi_fns.
+ * The generated pipeline takes the arguments in the following order:
+ *
+ *     input, x, rho, w0 ... w{N-1},
+ *     x_new, r, s, eps_pri, eps_dual, w0_new ... w{N-1}_new
+ */
+class HalfQuadraticSplittingIter : public Generator<HalfQuadraticSplittingIter> {
+    static constexpr auto W = problem_config::output_width;
+    static constexpr auto H = problem_config::output_height;
+    static constexpr auto N = problem_config::psi_size;
+
+    using InputBuffers = std::array<Input<Buffer<float>>*, N>;
+    using OutputBuffers = std::array<Output<Buffer<float>>*, N>;
+
+   public:
+    /** User-provided distorted, and noisy images.
+     *
+     * The third dimension indexes the images in a batch. Each image is solved
+     * independently, with its own convergence metrics.
+     */
+    Input<Buffer<float, 3>> input{"input"};
+
+    /** Initial estimate of the restored image. */
+    Input<Buffer<float, 3>> x_in{"x"};
+
+    /** Penalty of the quadratic coupling term, rho / 2 || K x - w ||^2 . */
+    Input<float> rho{"rho", 1.0f, 1e-5f, 1e5f};
+
+    /** Number of inner HQS iterations before computing convergence metrics. */
+    GeneratorParam<uint32_t> n_iter{"n_iter", 1ul, 1ul, 500ul};
+
+    /** Restored image, after a hard termination after iterating for n_iter
+     * times. */
+    Output<Buffer<float, 3>> x_new{"x_new"};
+
+    // Convergence metrics, one per image in the batch.
+    Output<Buffer<float, 1>> r{"r"};  //!< || x - x_prev ||
+    Output<Buffer<float, 1>> s{"s"};  //!< || w - w_prev ||
+    Output<Buffer<float, 1>> eps_pri{"eps_pri"};
+    Output<Buffer<float, 1>> eps_dual{"eps_dual"};
+
+    // Split variables w_i, one per psi_fns.
+    InputBuffers w{};
+    OutputBuffers w_new{};
+
+    void configure() {
+        using problem_definition::psi_fns;
+
+        for (size_t i = 0; i < N; i++) {
+            user_assert(psi_fns[i].n_dim == problem_config::psi_n_dim[i])
+                << "problem_config::psi_n_dim does not match psi_fns.";
+
+            const auto n_dim = psi_fns[i].n_dim;
+            const auto index = std::to_string(i);
+            w[i] = add_input<Buffer<float>>("w" + index, n_dim);
+            w_new[i] = add_output<Buffer<float>>("w" + index + "_new", n_dim);
+        }
+    }
+
+    void generate() {
+        using problem_definition::K;
+        using problem_definition::omega_fn;
+        using problem_definition::psi_fns;
+
+        user_assert(omega_fn.beta == 1.0f && omega_fn.gamma == 0.0f && omega_fn._c == 0.0f &&
+                    omega_fn.d == 0.0f)
+            << "The frequency domain inverse requires omega_fn = alpha || v - b ||^2 .";
+
+        x_list.resize(n_iter);
+        w_list.resize(n_iter);
+
+        const Expr input_size = W * H;
+        const Expr output_size = W * H;
+
+        // Reduce over each image, but not across the batch.
+        const RDom output_dimensions{0, W, 0, H, 0, problem_config::psi_k_extent};
+
+        // The offset b in omega_fn is the input image.
+        // The image gradient of K mirrors the image at the borders.
+        least_squares.emplace(K, input, omega_fn.alpha, target,
+                              algorithm::least_squares::Boundary::neumann);
+
+        for (size_t i = 0; i < n_iter; i++) {
+            const Func& x_prev = (i == 0) ? x_in : x_list[i - 1];
+
+            std::tie(x_list[i], w_list[i]) = algorithm::half_quadratic_splitting::iterate(
+                x_prev, K, *least_squares, psi_fns, rho);
+        }
+
+        const Func& x_prev = (n_iter > 1) ? *(x_list.rbegin() + 1) : Func(x_in);
+        FuncTuple<N> w_prev;
+        if (n_iter > 1) {
+            w_prev = *(w_list.rbegin() + 1);
+        } else {
+            for (size_t i = 0; i < N; i++) {
+                w_prev[i] = *w[i];
+            }
+        }
+
+        const auto [_r, _s, _eps_pri, _eps_dual] =
+            algorithm::half_quadratic_splitting::computeConvergence(
+                x_list.back(), x_prev, w_list.back(), w_prev, input_size, output_size,
+                output_dimensions);
+
+        // Export data
+        x_new = x_list.back();
+        for (size_t i = 0; i < N; i++) {
+            *w_new[i] = w_list.back()[i];
+        }
+        r(c) = _r;
+        s(c) = _s;
+        eps_pri(c) = _eps_pri;
+        eps_dual(c) = _eps_dual;
+    }
+
+    /** Inform Halide of the input and output image sizes.
+     *
+     * The batch size is determined at run time. All buffers must hold the same
+     * number of images.
+     */
+    void setBounds() {
+        input.dim(0).set_bounds(0, W);
+        input.dim(1).set_bounds(0, H);
+        input.dim(2).set_min(0);
+
+        const Expr batch_size = input.dim(2).extent();
+
+        const auto setImageBounds = [&](auto* a) {
+            a->dim(0).set_bounds(0, W);
+            a->dim(1).set_bounds(0, H);
+            a->dim(2).set_bounds(0, batch_size);
+
+            if (a->dimensions() == 4) {
+                a->dim(3).set_bounds(0, problem_config::psi_k_extent);
+            }
+        };
+
+        setImageBounds(&x_in);
+        setImageBounds(&x_new);
+        for (size_t i = 0; i < N; i++) {
+            setImageBounds(w[i]);
+            setImageBounds(w_new[i]);
+        }
+
+        for (auto* a : {&r, &s, &eps_pri, &eps_dual}) {
+            a->dim(0).set_bounds(0, batch_size);
+        }
+    }
+
+    void schedule() {
+        assert(!using_autoscheduler() && "Auto-scheduler not possible with manual schedules in FFT");
+
+        setBounds();
+
+        const auto vec_width = natural_vector_size<float>();
+
+        least_squares->schedule();
+
+        // The w_i are read by both the omega step, and the convergence check.
+        for (size_t i = 0; i + 1 < n_iter; i++) {
+            for (auto& f : w_list[i]) {
+                f.compute_root().vectorize(x, vec_width).parallel(y);
+            }
+        }
+
+        // Images in a batch are independent; iterate over them in the outermost loop.
+        for (auto* a : w_new) {
+            if (a->dimensions() == 4) {
+                a->reorder(k, x, y, c)
+                    .vectorize(x, vec_width)
+                    .parallel(y)
+                    .unroll(k, problem_config::psi_k_extent);
+            } else {
+                a->reorder(x, y, c).vectorize(x, vec_width).parallel(y);
+            }
+        }
+    }
+
+   private:
+    std::vector<Func> x_list;
+    std::vector<FuncTuple<N>> w_list;
+
+    std::optional<algorithm::least_squares::FrequencyDomainInverse<W, H>> least_squares;
+};
+
+HALIDE_REGISTER_GENERATOR(HalfQuadraticSplittingIter, hqs_iter);
@@ -0,0 +1,111 @@
+#include "hqs-runtime.h"
+
+#include <HalideBuffer.h>
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <vector>
+
+#include "hqs_iter.h"
+#include "pipeline-args.h"
+#include "problem-config.h"
+
+using Halide::Runtime::Buffer;
+
+namespace proximal {
+namespace runtime {
+
+constexpr auto W = problem_config::input_width;
+constexpr auto H = problem_config::input_height;
+
+signals_t
+hqsSolver(Buffer<const float>& input, const HqsSchedule& schedule) {
+    assert(input.dim(0).extent() == W);
+    assert(input.dim(1).extent() == H);
+    assert(schedule.rho_scale > 1.0f);
+    const auto start = std::chrono::steady_clock::now();
+
+    // Batch of one image.
+    Buffer<float> x(W, H, 1);
+    Buffer<float> x_new(W, H, 1);
+
+    // One w_i per psi_fns, either 3D or 4D.
+    std::vector<Buffer<float>> w;
+    std::vector<Buffer<float>> w_new;
+    for (const int n_dim : problem_config::psi_n_dim) {
+        const auto shape = (n_dim == 4) ? std::vector<int>{W, H, 1, problem_config::psi_k_extent}
+                                        : std::vector<int>{W, H, 1};
+
+        for (auto* p : {&w, &w_new}) {
+            p->emplace_back(shape);
+        }
+    }
+
+    // Set zeros
+    x.fill(0.0f);
+    x.set_host_dirty();
+    for (auto& buf : w) {
+        buf.fill(0.0f);
+        buf.set_host_dirty();
+    }
+
+    const size_t iter_max = schedule.max_outer_iters * schedule.max_inner_iters;
+    std::vector<float> r(iter_max);
+    std::vector<float> s(iter_max);
+    std::vector<float> eps_pri(iter_max);
+    std::vector<float> eps_dual(iter_max);
+
+    size_t i = 0;
+    float rho = schedule.rho_0;
+    for (size_t outer = 0; outer < schedule.max_outer_iters && rho < schedule.rho_max;
+         outer++) {
+        for (size_t inner = 0; inner < schedule.max_inner_iters; inner++, i++) {
+            Buffer<float> _r(r.data() + i, 1);
+            Buffer<float> _s(s.data() + i, 1);
+            Buffer<float> _eps_pri(eps_pri.data() + i, 1);
+            Buffer<float> _eps_dual(eps_dual.data() + i, 1);
+
+            PipelineArgs args;
+            args << input << x << rho << w << x_new << _r << _s << _eps_pri << _eps_dual << w_new;
+
+            const auto error = args.call(hqs_iter_argv);
+
+            if (error) {
+                return {error, {}, {}, {}, {}, {}};
+            }
+
+            for (auto* p : {&_r, &_s, &_eps_pri, &_eps_dual}) {
+                p->copy_to_host();
+            }
+
+            // This iteration's x_new becomes current x in the next iteration.
+            std::swap(x, x_new);
+            std::swap(w, w_new);
+
+            // Move on to the next rho, if x and w no longer change.
+            const bool converged = (r[i] < eps_pri[i]) && (s[i] < eps_dual[i]);
+            if (converged) {
+                i++;
+                break;
+            }
+        }
+
+        rho = std::min(rho * schedule.rho_scale, schedule.rho_max);
+    }
+
+    for (auto* v : {&r, &s, &eps_pri, &eps_dual}) {
+        v->resize(i);
+    }
+
+    x.copy_to_host();
+
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    constexpr int success = 0;
+    return {success, x, r, s, eps_pri, eps_dual, i, elapsed.count()};
+}
+
+}  // namespace runtime
+
+}  // namespace proximal
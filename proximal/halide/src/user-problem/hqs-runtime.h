@@ -0,0 +1,42 @@
+#pragma once
+
+#include <HalideBuffer.h>
+
+#include "signals.h"
+
+namespace proximal {
+namespace runtime {
+
+/** Geometric continuation schedule of the penalty rho, as in
+ * half_quadratic_splitting.py .
+ *
+ * The outer iterations multiply rho by rho_scale, starting from rho_0, until
+ * rho_max or max_outer_iters is reached. For fast previews, set a small
+ * max_outer_iters and max_inner_iters instead of tightening the tolerances.
+ */
+struct HqsSchedule {
+    float rho_0 = 1.0f;
+    float rho_scale = 2.0f * 1.41421356f;
+    float rho_max = 256.0f;
+
+    size_t max_outer_iters = 8;
+    size_t max_inner_iters = 10;
+};
+
+/** Runtime function to call half-quadratic splitting (HQS), with early
+ * termination of the inner iterations.
+ *
+ * Same as ladmmSolver(), except that the Halide-optimized AOT pipeline
+ * iterates HQS with the rho continuation in HqsSchedule. The metrics are
+ * recorded once per inner iteration: signals_t::r and signals_t::s are the
+ * changes of x and w between the iterations.
+ *
+ * The tolerances eps_abs = eps_rel = 1e-3 of the inner convergence criteria
+ * are compiled into the pipeline. Only the image size defined in problem_config
+ * is supported.
+ */
+signals_t hqsSolver(Buffer<const float>& input, const HqsSchedule& schedule = {});
+
+}  // namespace runtime
+
+}  // namespace proximal
@@ -2,7 +2,22 @@
 
 #include <HalideBuffer.h>
 
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <random>
+
 #include "ladmm_iter.h"
+#include "ladmm_iter_accelerated.h"
+#include "ladmm_iter_dynamic.h"
+#include "ladmm_iter_relaxed.h"
+#include "ladmm_iter_x16.h"
+#include "ladmm_iter_x4.h"
+#include "pipeline-args.h"
+#include "power_iter.h"
 #include "problem-config.h"
 
 using Halide::Runtime::Buffer;
@@ -13,44 +28,345 @@ namespace runtime {
 constexpr auto W = problem_config::input_width;
 constexpr auto H = problem_config::input_height;
 
+namespace {
+
+/** The ladmm_iter pipelines, called through the argv entry points, so that the
+ * number of z_i, u_i is determined by problem_config::psi_size. */
+using ladmm_iter_t = pipeline_argv_t;
+
+/** Halide pipeline unrolled for n_iter iterations per convergence check. */
+struct variant_t {
+    size_t n_iter;
+    ladmm_iter_t pipeline;
+};
+
+// Sorted by the number of iterations, in descending order.
+const std::vector<variant_t> fixed_size_variants{
+    {16, ladmm_iter_x16_argv},
+    {4, ladmm_iter_x4_argv},
+    {1, ladmm_iter_argv},
+};
+
+const std::vector<variant_t> dynamic_size_variants{
+    {1, ladmm_iter_dynamic_argv},
+};
+
+const std::vector<variant_t> relaxed_variants{
+    {1, ladmm_iter_relaxed_argv},
+};
+
+// The momentum is updated after every iteration.
+const std::vector<variant_t> accelerated_variants{
+    {1, ladmm_iter_accelerated_argv},
+};
+
+bool
+isDefaultSize(const Buffer<const float>& input) {
+    return (input.dim(0).extent() == W) && (input.dim(1).extent() == H);
+}
+
+/** Select the Halide pipelines by the image size, and the update policy. */
+const std::vector<variant_t>&
+selectVariants(const Buffer<const float>& input,
+               const Acceleration acceleration = Acceleration::none) {
+    if (!isDefaultSize(input)) {
+        return dynamic_size_variants;
+    }
+
+    switch (acceleration) {
+        case Acceleration::over_relaxation:
+            return relaxed_variants;
+        case Acceleration::momentum:
+            return accelerated_variants;
+        default:
+            return fixed_size_variants;
+    }
+}
+
+/** Select the single-iteration Halide pipeline by the image size. */
+ladmm_iter_t
+selectPipeline(const Buffer<const float>& input) {
+    return selectVariants(input).back().pipeline;
+}
+
+/** Distance to convergence; the criteria are met when less than one. */
+float
+convergenceGap(const float r, const float s, const float eps_pri, const float eps_dual) {
+    return std::max(r / eps_pri, s / eps_dual);
+}
+
+/** Predict the number of iterations until convergence.
+ *
+ * Assume that the gap decays geometrically, at the rate observed between the
+ * last two convergence checks, n_iter iterations apart. Returns one, i.e.
+ * check at every iteration, when the gap is not decreasing.
+ */
+size_t
+predictRemainingIterations(const float gap, const float gap_prev, const size_t n_iter) {
+    if (gap_prev <= 0.0f || gap >= gap_prev || gap <= 1.0f) {
+        return 1;
+    }
+
+    const float log_rate = std::log(gap / gap_prev) / n_iter;
+    return static_cast<size_t>(std::ceil(std::log(gap) / -log_rate));
+}
+
+/** Pick the longest pipeline that does not overshoot the predicted convergence. */
+const variant_t&
+pickVariant(const std::vector<variant_t>& variants, const size_t remaining,
+            const size_t budget) {
+    for (const auto& variant : variants) {
+        if (variant.n_iter <= remaining && variant.n_iter <= budget) {
+            return variant;
+        }
+    }
+    return variants.back();
+}
+
+/** Re-balance the primal and dual residuals, when they differ by this ratio. */
+constexpr float residual_ratio = 10.0f;
+
+/** Rescale lmb and mu by this factor in each re-balancing. */
+constexpr float penalty_scale = 2.0f;
+
+/** Residual balancing of the scaling factor lmb.
+ *
+ * The penalty parameter of the ADMM is 1 / lmb. A large primal residual
+ * calls for a larger penalty, and vice versa. Returns the factor to scale
+ * lmb, mu and the scaled dual variables u_i, or one if they are balanced.
+ */
+float
+balanceResiduals(const float r, const float s) {
+    if (r > residual_ratio * s) {
+        return 1.0f / penalty_scale;
+    }
+
+    if (s > residual_ratio * r) {
+        return penalty_scale;
+    }
+
+    return 1.0f;
+}
+
+/** Nesterov's momentum, with adaptive restart.
+ *
+ * Reference: Goldstein et al. (2014), "Fast alternating direction optimization
+ * methods", algorithm 8.
+ */
+struct Momentum {
+    /** Restart unless the combined residual decreases by this ratio. */
+    static constexpr float restart_ratio = 0.999f;
+
+    float t = 1.0f;
+    float value = 0.0f;
+    float combined_prev = std::numeric_limits<float>::infinity();
+
+    /** Update the momentum from the residuals of the last iteration. */
+    void update(const float r, const float s) {
+        const float combined = r * r + s * s;
+        if (combined >= restart_ratio * combined_prev) {
+            restart();
+            combined_prev = combined;
+            return;
+        }
+
+        const float t_next = (1.0f + std::sqrt(1.0f + 4.0f * t * t)) / 2.0f;
+        value = (t - 1.0f) / t_next;
+        t = t_next;
+        combined_prev = combined;
+    }
+
+    void restart() {
+        t = 1.0f;
+        value = 0.0f;
+    }
+};
+
+double
+secondsSince(const std::chrono::steady_clock::time_point start) {
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+}  // namespace
+
+LadmmWorkspace::LadmmWorkspace(const size_t iter_max, const int batch_size)
+    : LadmmWorkspace(iter_max, batch_size, W, H) {}
+
+LadmmWorkspace::LadmmWorkspace(const size_t iter_max, const int batch_size, const int width,
+                               const int height)
+    : v(width, height, batch_size), v_new(width, height, batch_size) {
+    // One z_i, u_i per psi_fns, either 3D or 4D.
+    for (const int n_dim : problem_config::psi_n_dim) {
+        const auto shape = (n_dim == 4) ? std::vector<int>{width, height, batch_size,
+                                                           problem_config::psi_k_extent}
+                                        : std::vector<int>{width, height, batch_size};
+
+        for (auto* p : {&z, &u, &z_new, &u_new}) {
+            p->emplace_back(shape);
+        }
+    }
+
+    for (auto* p : {&r, &s, &eps_pri, &eps_dual}) {
+        p->reserve(iter_max);
+    }
+}
+
+void
+LadmmWorkspace::reset() {
+    // Set zeros
+    v.fill(0.0f);
+    v.set_host_dirty();
+
+    for (auto* p : {&z, &u}) {
+        for (auto& buf : *p) {
+            buf.fill(0.0f);
+            buf.set_host_dirty();
+        }
+    }
+
+    lmb = lmb_init;
+    mu = mu_init;
+}
+
+int
+LadmmWorkspace::estimateScaling(const float _lmb) {
+    float K_norm = 0.0f;
+    const auto error = estimateOperatorNorm(width(), height(), K_norm);
+    if (error) {
+        return error;
+    }
+
+    lmb_init = std::max(_lmb, 1e-5f);
+    mu_init = lmb_init / (K_norm * K_norm);
+    reset();
+
+    return 0;
+}
+
+int
+estimateOperatorNorm(const int width, const int height, float& norm, const size_t iter_max,
+                     const float tol) {
+    // Must match the generator parameter n_iter of power_iter.
+    constexpr size_t n_iter = 10;
+
+    // Random initial estimate, so that it is unlikely orthogonal to the
+    // dominant eigenvector.
+    std::mt19937 rng{42};
+    std::uniform_real_distribution<float> uniform{-1.0f, 1.0f};
+
+    Buffer<float> v(width, height, 1);
+    double sumsq = 0.0;
+    v.for_each_value([&](float& _v) {
+        _v = uniform(rng);
+        sumsq += _v * _v;
+    });
+
+    const auto scale = static_cast<float>(1.0 / std::sqrt(sumsq));
+    v.for_each_value([scale](float& _v) { _v *= scale; });
+    v.set_host_dirty();
+
+    Buffer<float> v_new(width, height, 1);
+
+    float eigenvalue = 0.0f;
+    Buffer<float> _eigenvalue(&eigenvalue, 1);
+
+    float eigenvalue_prev = 0.0f;
+    for (size_t i = 0; i < iter_max; i += n_iter) {
+        const auto error = power_iter(v, v_new, _eigenvalue);
+        if (error) {
+            return error;
+        }
+        _eigenvalue.copy_to_host();
+
+        const bool converged = std::abs(eigenvalue - eigenvalue_prev) < tol * eigenvalue;
+        if (converged) {
+            break;
+        }
+
+        eigenvalue_prev = eigenvalue;
+        std::swap(v, v_new);
+    }
+
+    // The largest eigenvalue of K^T K is || K ||^2 .
+    norm = std::sqrt(eigenvalue);
+    return 0;
+}
+
 signals_t
 ladmmSolver(Buffer<const float>& input, const size_t iter_max, const float eps_abs,
             const float eps_rel) {
-    Buffer<float> v(W, H, 1);
-    Buffer<float> z0(W, H, 1, 2);
-    Buffer<float> z1(W, H, 1);
-    Buffer<float> u0(W, H, 1, 2);
-    Buffer<float> u1(W, H, 1);
+    LadmmWorkspace workspace{iter_max, 1, input.dim(0).extent(), input.dim(1).extent()};
+    return ladmmSolver(input, workspace, iter_max);
+}
 
-    // Set zeros
-    for (auto* buf : {&v, &z0, &z1, &u0, &u1}) {
-        buf->fill(0.0f);
+signals_t
+ladmmSolver(Buffer<const float>& input, LadmmWorkspace& workspace, const size_t iter_max) {
+    workspace.reset();
+    return ladmmSolverWarmStart(input, workspace, iter_max);
+}
+
+signals_t
+ladmmSolverWarmStart(Buffer<const float>& input, LadmmWorkspace& workspace,
+                     const size_t iter_max) {
+    auto [v, z, u] = std::tie(workspace.v, workspace.z, workspace.u);
+    auto [v_new, z_new, u_new] = std::tie(workspace.v_new, workspace.z_new, workspace.u_new);
+    auto [r, s, eps_pri, eps_dual] =
+        std::tie(workspace.r, workspace.s, workspace.eps_pri, workspace.eps_dual);
+    auto [z_prev, u_prev] = std::tie(workspace.z_prev, workspace.u_prev);
+
+    assert(workspace.width() == input.dim(0).extent());
+    assert(workspace.height() == input.dim(1).extent());
+    const auto& variants = selectVariants(input, workspace.acceleration);
+    const bool accelerated =
+        (workspace.acceleration == Acceleration::momentum) && isDefaultSize(input);
+
+    const auto start = std::chrono::steady_clock::now();
+
+    Momentum momentum;
+    if (accelerated) {
+        // Start without momentum: the previous iterates are the current ones.
+        for (auto [prev, current] : {std::tie(z_prev, z), std::tie(u_prev, u)}) {
+            prev.resize(current.size());
+            for (size_t n = 0; n < current.size(); n++) {
+                if (!prev[n].defined()) {
+                    prev[n] = Buffer<float>::make_with_shape_of(current[n]);
+                }
+                current[n].copy_to_host();
+                prev[n].copy_from(current[n]);
+                prev[n].set_host_dirty();
+            }
+        }
     }
 
-    for(auto* p : {&v, &z0, &z1, &u0, &u1}) {
-        p->set_host_dirty();
+    // Re-use the capacity reserved by the workspace. There is at most one
+    // convergence check per iteration.
+    for (auto* p : {&r, &s, &eps_pri, &eps_dual}) {
+        p->resize(iter_max);
     }
 
-    Buffer<float> z0_new(W, H, 1, 2);
-    Buffer<float> z1_new(W, H, 1);
-    Buffer<float> u0_new(W, H, 1, 2);
-    Buffer<float> u1_new(W, H, 1);
+    size_t n_iter = 0;
+    size_t remaining = 1;
+    float gap_prev = 0.0f;
 
-    Buffer<float> v_new(W, H, 1);
+    size_t i = 0;
+    while (n_iter < iter_max) {
+        const auto& [steps, pipeline] = pickVariant(variants, remaining, iter_max - n_iter);
 
-    std::vector<float> r(iter_max);
-    std::vector<float> s(iter_max);
-    std::vector<float> eps_pri(iter_max);
-    std::vector<float> eps_dual(iter_max);
+        // Batch of one image.
+        Buffer<float> _r(r.data() + i, 1);
+        Buffer<float> _s(s.data() + i, 1);
+        Buffer<float> _eps_pri(eps_pri.data() + i, 1);
+        Buffer<float> _eps_dual(eps_dual.data() + i, 1);
 
-    for (size_t i = 0; i < iter_max; i++) {
-        auto _r = Buffer<float>::make_scalar(r.data() + i);
-        auto _s = Buffer<float>::make_scalar(s.data() + i);
-        auto _eps_pri = Buffer<float>::make_scalar(eps_pri.data() + i);
-        auto _eps_dual = Buffer<float>::make_scalar(eps_dual.data() + i);
+        PipelineArgs args;
+        args << input << v << workspace.lmb << workspace.mu << z << u;
+        if (accelerated) {
+            args << momentum.value << z_prev << u_prev;
+        }
+        args << v_new << _r << _s << _eps_pri << _eps_dual << z_new << u_new;
 
-        const auto error = ladmm_iter(input, v, z0, z1, u0, u1, v_new, z0_new, z1_new, u0_new,
-                                      u1_new, _r, _s, _eps_pri, _eps_dual);
+        const auto error = args.call(pipeline);
 
         if (error) {
             return {error, {}, {}, {}, {}, {}};
@@ -61,30 +377,221 @@ ladmmSolver(Buffer<const float>& input, const size_t iter_max, const float eps_a
             p->copy_to_host();
         }
 
-        const bool converged = (r[i] < eps_pri[i]) && (s[i] < eps_dual[i]);
-        if (converged) {
-            for (auto* v : {&r, &s, &eps_pri, &eps_dual}) {
-                v->resize(i + 1);
-            }
+        n_iter += steps;
+        i++;
+
+        const float gap = convergenceGap(r[i - 1], s[i - 1], eps_pri[i - 1], eps_dual[i - 1]);
+        const bool converged = (gap < 1.0f);
+        if (converged || n_iter >= iter_max) {
             break;
         }
 
-        if (i != iter_max - 1) {
-            // This iteration's v_new becomes current v in the next iteration.
-            std::swap(v, v_new);
-            std::swap(u0, u0_new);
-            std::swap(u1, u1_new);
-            std::swap(z0, z0_new);
-            std::swap(z1, z1_new);
+        remaining = predictRemainingIterations(gap, gap_prev, steps);
+        gap_prev = gap;
+
+        if (accelerated) {
+            momentum.update(r[i - 1], s[i - 1]);
+
+            // This iteration's z_i, u_i become the previous ones in the next iteration.
+            std::swap(z_prev, z);
+            std::swap(u_prev, u);
+        }
+
+        // This iteration's v_new becomes current v in the next iteration.
+        std::swap(v, v_new);
+        std::swap(u, u_new);
+        std::swap(z, z_new);
+
+        const float scale =
+            workspace.residual_balancing ? balanceResiduals(r[i - 1], s[i - 1]) : 1.0f;
+        if (scale != 1.0f) {
+            workspace.lmb *= scale;
+            workspace.mu *= scale;
+
+            // u_i is the dual variable scaled by lmb.
+            for (auto* p : {&u, &u_prev}) {
+                for (auto& buf : *p) {
+                    buf.copy_to_host();
+                    buf.for_each_value([scale](float& _u) { _u *= scale; });
+                    buf.set_host_dirty();
+                }
+            }
+            momentum.restart();
+
+            // The decay rate is no longer valid after rescaling.
+            remaining = 1;
+            gap_prev = 0.0f;
         }
     }
 
-    v_new.copy_to_host();
+    for (auto* p : {&r, &s, &eps_pri, &eps_dual}) {
+        p->resize(i);
+    }
+
+    // Retain the final state in the workspace, so that the next solve can
+    // resume from it. Without any pipeline call, e.g. iter_max = 0, the state
+    // is already in v, z_i, u_i.
+    if (i > 0) {
+        std::swap(v, v_new);
+        std::swap(u, u_new);
+        std::swap(z, z_new);
+    }
+
+    v.copy_to_host();
 
     constexpr int success = 0;
-    return {success, v_new, r, s, eps_pri, eps_dual};
+    return {success, v, r, s, eps_pri, eps_dual, n_iter, secondsSince(start)};
+}
+
+std::vector<signals_t>
+ladmmSolverBatch(Buffer<const float>& input, const size_t iter_max) {
+    LadmmWorkspace workspace{iter_max, input.dim(2).extent(), input.dim(0).extent(),
+                             input.dim(1).extent()};
+    auto signals = ladmmSolverBatch(input, workspace, iter_max);
+
+    // Detach the restored images from the temporary workspace.
+    for (auto& signal : signals) {
+        signal.v_new = signal.v_new.copy();
+    }
+    return signals;
+}
+
+std::vector<signals_t>
+ladmmSolverBatch(Buffer<const float>& input, LadmmWorkspace& workspace,
+                 const size_t iter_max) {
+    const int batch_size = input.dim(2).extent();
+    const int width = input.dim(0).extent();
+    const int height = input.dim(1).extent();
+    assert(workspace.batchSize() == batch_size);
+    assert(workspace.width() == width);
+    assert(workspace.height() == height);
+    const auto pipeline = selectPipeline(input);
+    const auto start = std::chrono::steady_clock::now();
+
+    // Allocate the buffers of the batched solver on first use.
+    if (!workspace.input.defined()) {
+        workspace.input = Buffer<float>(width, height, batch_size);
+        workspace.v_final = Buffer<float>(width, height, batch_size);
+
+        for (auto* p : {&workspace.r_batch, &workspace.s_batch, &workspace.eps_pri_batch,
+                        &workspace.eps_dual_batch}) {
+            *p = Buffer<float>(batch_size);
+        }
+    }
+
+    workspace.reset();
+
+    // The state buffers, whose images are reordered as the images converge.
+    const auto state = [&workspace]() {
+        std::vector<Buffer<float>*> buffers{&workspace.input, &workspace.v};
+        for (auto* p : {&workspace.z, &workspace.u}) {
+            for (auto& buf : *p) {
+                buffers.push_back(&buf);
+            }
+        }
+        return buffers;
+    };
+
+    workspace.input.copy_from(input);
+    workspace.input.set_host_dirty();
+
+    // The original index of the image stored at each position in the batch.
+    std::vector<int> image_index(batch_size);
+    std::iota(image_index.begin(), image_index.end(), 0);
+
+    std::vector<signals_t> signals(batch_size);
+    for (int n = 0; n < batch_size; n++) {
+        signals[n].error_code = 0;
+        signals[n].v_new = workspace.v_final.sliced(2, n);
+    }
+
+    // Images [0, n_active) have yet to converge.
+    int n_active = batch_size;
+
+    for (size_t i = 0; i < iter_max && n_active > 0; i++) {
+        const auto active = [n_active](Buffer<float>& buf) {
+            return buf.cropped(buf.dimensions() == 1 ? 0 : 2, 0, n_active);
+        };
+
+        PipelineArgs args;
+        args << active(workspace.input) << active(workspace.v) << workspace.lmb << workspace.mu;
+        for (auto* p : {&workspace.z, &workspace.u}) {
+            for (auto& buf : *p) {
+                args << active(buf);
+            }
+        }
+
+        args << active(workspace.v_new) << active(workspace.r_batch) << active(workspace.s_batch)
+             << active(workspace.eps_pri_batch) << active(workspace.eps_dual_batch);
+        for (auto* p : {&workspace.z_new, &workspace.u_new}) {
+            for (auto& buf : *p) {
+                args << active(buf);
+            }
+        }
+
+        const auto error = args.call(pipeline);
+
+        if (error) {
+            for (auto& signal : signals) {
+                signal = {error, {}, {}, {}, {}, {}};
+            }
+            return signals;
+        }
+
+        for (auto* p : {&workspace.r_batch, &workspace.s_batch, &workspace.eps_pri_batch,
+                        &workspace.eps_dual_batch}) {
+            p->copy_to_host();
+        }
+
+        // This iteration's v_new becomes current v in the next iteration.
+        std::swap(workspace.v, workspace.v_new);
+        std::swap(workspace.u, workspace.u_new);
+        std::swap(workspace.z, workspace.z_new);
+
+        const bool last_iteration = (i == iter_max - 1);
+        if (last_iteration) {
+            workspace.v.copy_to_host();
+        }
+
+        // Walk backwards, so that swapping in the last active image does not
+        // skip the convergence check of any image.
+        for (int j = n_active - 1; j >= 0; j--) {
+            auto& signal = signals[image_index[j]];
+            signal.r.push_back(workspace.r_batch(j));
+            signal.s.push_back(workspace.s_batch(j));
+            signal.eps_pri.push_back(workspace.eps_pri_batch(j));
+            signal.eps_dual.push_back(workspace.eps_dual_batch(j));
+
+            const bool converged = (workspace.r_batch(j) < workspace.eps_pri_batch(j)) &&
+                                   (workspace.s_batch(j) < workspace.eps_dual_batch(j));
+            if (!converged && !last_iteration) {
+                continue;
+            }
+
+            if (!last_iteration) {
+                workspace.v.copy_to_host();
+            }
+            signal.v_new.copy_from(workspace.v.sliced(2, j));
+            signal.n_iter = i + 1;
+            signal.elapsed = secondsSince(start);
+
+            // Move the last active image into the vacated position.
+            const int last = n_active - 1;
+            if (j != last) {
+                for (auto* buf : state()) {
+                    buf->copy_to_host();
+                    buf->sliced(2, j).copy_from(buf->sliced(2, last));
+                    buf->set_host_dirty();
+                }
+                image_index[j] = image_index[last];
+            }
+            n_active--;
+        }
+    }
+
+    return signals;
 }
 
 }  // namespace runtime
 
-}  // namespace proximal
\ No newline at end of file
+}  // namespace proximal
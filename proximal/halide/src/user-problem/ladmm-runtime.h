@@ -2,20 +2,125 @@
 
 #include <HalideBuffer.h>
 
+#include <vector>
+
+#include "signals.h"
+
 namespace proximal {
 namespace runtime {
 
 using Halide::Runtime::Buffer;
 
-struct signals_t {
-    int error_code;
+/** Update policy of the (L-)ADMM iterations.
+ *
+ * Only effective for the image size defined in problem_config; the other
+ * image sizes fall back to the plain update.
+ */
+enum class Acceleration {
+    none,             //!< Plain update, with adaptive iterations per convergence check.
+    over_relaxation,  //!< Over-relaxed update, with alpha = 1.5 .
+    momentum,         //!< Momentum-accelerated update, with adaptive restart.
+};
+
+/** Pre-allocated buffers for the (L-)ADMM solver.
+ *
+ * The solver double-buffers the variables v, z_i and u_i: the outputs of the
+ * current iteration become the inputs of the next one. Allocating, and then
+ * page-faulting, these full-size buffers dominates the latency of small
+ * images. Create one workspace per thread, and then pass it to repeated calls
+ * of ladmmSolver() on same-sized images.
+ *
+ * The workspace is not thread-safe. The returned signals_t::v_new shares the
+ * memory with the workspace, and is overwritten by the next solve.
+ *
+ * After each call of ladmmSolver(), the final estimates are retained in v,
+ * z_i, and u_i. Pass the workspace to ladmmSolverWarmStart() to resume from
+ * them.
+ */
+struct LadmmWorkspace {
+    /** Allocate the buffers for the image size defined in problem_config. */
+    explicit LadmmWorkspace(size_t iter_max = 100, int batch_size = 1);
+
+    /** Allocate the buffers for an image size known only at run time. */
+    LadmmWorkspace(size_t iter_max, int batch_size, int width, int height);
+
+    /** Reset the initial estimates v, z_i, u_i to zeros, and the problem
+     * scaling factors to lmb_init, mu_init. */
+    void reset();
+
+    /** Estimate the problem scaling factors from the operator norm || K ||.
+     *
+     * Sets lmb_init = _lmb, and mu_init = _lmb / || K ||^2, as in
+     * proximal.algorithms.linearized_admm.est_params_lin_admm(). Then, reset the
+     * workspace. Call it once before the first solve. Returns the error code of
+     * the Halide pipeline.
+     */
+    int estimateScaling(float _lmb = 1.0f);
+
+    /** Number of images solved together by ladmmSolverBatch(). */
+    int batchSize() const { return v.dim(2).extent(); }
+
+    int width() const { return v.dim(0).extent(); }
+    int height() const { return v.dim(1).extent(); }
+
+    /** Initial problem scaling factors. Defaults to lmb = 1, mu = lmb / || K ||^2
+     * with || K ||^2 = 9, or set by estimateScaling(). */
+    float lmb_init = 1.0f;
+    float mu_init = 0.11111f;
+
+    /** Re-balance the primal and dual residuals, by rescaling lmb and mu. */
+    bool residual_balancing = true;
+
+    /** Update policy of ladmmSolver(). The batched solver ignores it. */
+    Acceleration acceleration = Acceleration::none;
+
+    // Current problem scaling factors, updated by the residual balancing.
+    float lmb = lmb_init;
+    float mu = mu_init;
+
+    Buffer<float> v;
+
+    // Split variables z_i, and scaled dual variables u_i, one per psi_fns.
+    std::vector<Buffer<float>> z;
+    std::vector<Buffer<float>> u;
+
     Buffer<float> v_new;
+    std::vector<Buffer<float>> z_new;
+    std::vector<Buffer<float>> u_new;
+
+    // Convergence metrics, one per iteration.
     std::vector<float> r;
     std::vector<float> s;
     std::vector<float> eps_pri;
     std::vector<float> eps_dual;
+
+    // Momentum-accelerated solver only: z_i, u_i of the previous iteration.
+    std::vector<Buffer<float>> z_prev;
+    std::vector<Buffer<float>> u_prev;
+
+    // Batched solver only: a copy of the input images, reordered so that the
+    // unconverged images are stored contiguously in the front.
+    Buffer<float> input;
+
+    // Batched solver only: convergence metrics of the current iteration, one per image.
+    Buffer<float> r_batch;
+    Buffer<float> s_batch;
+    Buffer<float> eps_pri_batch;
+    Buffer<float> eps_dual_batch;
+
+    // Batched solver only: the restored images, in the original order.
+    Buffer<float> v_final;
 };
 
+/** Estimate the operator norm || K || by power iteration on K^T K.
+ *
+ * The linear operator K is the same as the one of the (L-)ADMM pipelines, for
+ * images of the given size. Iterate until the relative change of the estimate
+ * is below tol. Returns the error code of the Halide pipeline.
+ */
+int estimateOperatorNorm(int width, int height, float& norm, const size_t iter_max = 100,
+                         const float tol = 1e-3);
+
 /** Runtime function to call (L-)ADMM, with early termination.
  *
  * Halide being a non-Turing complete language, is unable to dynamically
@@ -26,10 +131,72 @@ struct signals_t {
  * Then, we check the convergence criteria, and terminate the for-loop when the
  * criteria are met. Otherwise, repeat for another (10) iterations.
  *
+ * Several pipelines unrolled for 1, 4, and 16 iterations are compiled. The
+ * number of iterations before the next check is picked adaptively: the decay
+ * rate of the residuals between the last two checks predicts the remaining
+ * iterations, and the longest pipeline not overshooting the prediction runs
+ * next. The image sizes known only at run time are checked every iteration.
+ *
+ * When the primal residual r and the dual residual s differ by more than 10x,
+ * the scaling factors lmb and mu are rescaled by 2x, and the scaled dual
+ * variables u_i by the same factor, to balance the two residuals. This
+ * follows the residual balancing scheme in Boyd et al. (2011), section 3.4.1.
+ *
+ * With Acceleration::momentum, z_i and u_i are extrapolated with Nesterov's
+ * momentum. The momentum restarts from zero whenever the combined residual
+ * r^2 + s^2 fails to decrease, as in Goldstein et al. (2014).
+ *
+ * The Halide pipeline is selected by the shape of the input buffer: the
+ * image size defined in problem_config runs the pipeline compiled for that
+ * size; any other size runs the pipeline whose size is determined at run time.
+ *
+ * The tolerances eps_abs = eps_rel = 1e-3 of the convergence criteria are
+ * compiled into the pipelines. The arguments eps_abs and eps_rel are unused,
+ * and kept for compatibility only.
+ *
  * Reference: https://stackoverflow.com/a/33472074
  */
 signals_t ladmmSolver(Buffer<const float>& input, const size_t iter_max = 100,
                       const float eps_abs = 1e-3, const float eps_rel = 1e-3);
+
+/** Runtime function to call (L-)ADMM, re-using the pre-allocated buffers.
+ *
+ * Same as above, except that the intermediate buffers are taken from the
+ * user-provided workspace.
+ */
+signals_t ladmmSolver(Buffer<const float>& input, LadmmWorkspace& workspace,
+                      const size_t iter_max = 100);
+
+/** Runtime function to call (L-)ADMM, starting from the estimates in the workspace.
+ *
+ * Same as above, except that v, z_i, u_i are not reset to zeros. They are
+ * either the final estimates of the previous solve, e.g. of the previous frame
+ * of a video, or the initial estimates written by the caller. In the latter
+ * case, call Buffer::set_host_dirty() after writing them.
+ *
+ * On return, the final estimates of v, z_i, u_i are in the workspace, for the
+ * caller to chain the next solve.
+ */
+signals_t ladmmSolverWarmStart(Buffer<const float>& input, LadmmWorkspace& workspace,
+                               const size_t iter_max = 100);
+
+/** Runtime function to call (L-)ADMM on a batch of images.
+ *
+ * The input buffer is of the dimensions W x H x batch_size. All images in the
+ * batch are iterated together in a single pipeline invocation, so that the
+ * cores stay busy. Once an image converges, it is swapped out of the active
+ * range of the batch, and no longer costs compute.
+ *
+ * Returns the convergence metrics of each image, in the original order.
+ *
+ * The scaling factors lmb and mu are shared by the batch; they are fixed to
+ * lmb_init and mu_init, without residual balancing.
+ */
+std::vector<signals_t> ladmmSolverBatch(Buffer<const float>& input, LadmmWorkspace& workspace,
+                                        const size_t iter_max = 100);
+
+/** Runtime function to call (L-)ADMM on a batch of images, allocating a new workspace. */
+std::vector<signals_t> ladmmSolverBatch(Buffer<const float>& input, const size_t iter_max = 100);
 }  // namespace runtime
 
-}  // namespace proximal
\ No newline at end of file
+}  // namespace proximal
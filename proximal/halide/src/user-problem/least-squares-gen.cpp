@@ -0,0 +1,74 @@
+#include <Halide.h>
+using namespace Halide;
+
+#include <optional>
+
+#include "least-squares.h"
+#include "problem-definition.h"
+
+/** Residual of the frequency domain inverse, for testing.
+ *
+ * Solve the v-update of the ADMM with
+ * algorithm::least_squares::FrequencyDomainInverse, and then evaluate the
+ * normal equation with the spatial operator K of problem_definition:
+ *
+ *     residual = (rho I + K^T K) v - (K^T w + rho b),   rho = 2 alpha lmb .
+ *
+ * The residual vanishes everywhere, including at the image borders, only if
+ * the boundary condition of the inverse is that of K.
+ */
+class LeastSquaresResidual : public Generator<LeastSquaresResidual> {
+    static constexpr auto W = problem_config::output_width;
+    static constexpr auto H = problem_config::output_height;
+
+    using Boundary = algorithm::least_squares::Boundary;
+
+   public:
+    /** Offset b of omega_fn, i.e. the input image. */
+    Input<Buffer<float, 3>> b{"b"};
+
+    /** K^T w, with w = z - u in the ADMM. */
+    Input<Buffer<float, 3>> KTw{"KTw"};
+
+    Input<float> lmb{"lmb", 1.0f, 1e-5f, 1e5f};
+
+    GeneratorParam<Boundary> boundary{"boundary",
+                                      Boundary::neumann,
+                                      {{"periodic", Boundary::periodic},
+                                       {"neumann", Boundary::neumann}}};
+
+    Output<Buffer<float, 3>> residual{"residual"};
+
+    void generate() {
+        using problem_definition::K;
+        using problem_definition::omega_fn;
+
+        least_squares.emplace(K, b, omega_fn.alpha, target, boundary);
+        const Func v = (*least_squares)(KTw, lmb);
+
+        const Expr rho = 2.0f * omega_fn.alpha * lmb;
+        const Func KTKv = K.adjoint(K.forward(v));
+        residual(x, y, c) = rho * v(x, y, c) + KTKv(x, y, c) - KTw(x, y, c) - rho * b(x, y, c);
+    }
+
+    void schedule() {
+        for (auto* a : {&b, &KTw}) {
+            a->dim(0).set_bounds(0, W);
+            a->dim(1).set_bounds(0, H);
+            a->dim(2).set_bounds(0, 1);
+        }
+        residual.dim(0).set_bounds(0, W);
+        residual.dim(1).set_bounds(0, H);
+        residual.dim(2).set_bounds(0, 1);
+
+        least_squares->schedule();
+
+        const auto vec_width = natural_vector_size<float>();
+        residual.vectorize(x, vec_width).parallel(y);
+    }
+
+   private:
+    std::optional<algorithm::least_squares::FrequencyDomainInverse<W, H>> least_squares;
+};
+
+HALIDE_REGISTER_GENERATOR(LeastSquaresResidual, least_squares_residual);
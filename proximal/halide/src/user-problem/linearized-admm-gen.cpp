@@ -4,31 +4,48 @@ using namespace Halide;
 #include "linearized-admm.h"
 #include "problem-definition.h"
 
+/** Update policies of the L-ADMM iteration, see algorithm::linearized_admm::policy. */
+enum class Update { plain, over_relaxed, accelerated };
+
+/** Halide-optimized (L-)ADMM iterations for the problem in problem_definition.
+ *
+ * The variables z_i, u_i are created in configure(), one per function in
+ * psi_fns, with the dimensions given by ParameterizedProx::n_dim. The
+ * generated pipeline takes the arguments in the following order:
+ *
+ *     input, v, lmb, mu, z0 ... z{N-1}, u0 ... u{N-1},
+ *     [momentum, z_prev0 ... z_prev{N-1}, u_prev0 ... u_prev{N-1},]
+ *     v_new, r, s, eps_pri, eps_dual, z0_new ... z{N-1}_new, u0_new ... u{N-1}_new
+ *
+ * where the bracketed arguments exist only for the accelerated update.
+ */
 class LinearizedADMMIter : public Generator<LinearizedADMMIter> {
     static constexpr auto W = problem_config::output_width;
     static constexpr auto H = problem_config::output_height;
+    static constexpr auto N = problem_config::psi_size;
+
+    using InputBuffers = std::array<Input<Buffer<float>>*, N>;
+    using OutputBuffers = std::array<Output<Buffer<float>>*, N>;
 
    public:
-    /** User-provided distorted, and noisy image. */
+    /** User-provided distorted, and noisy images.
+     *
+     * The third dimension indexes the images in a batch. Each image is solved
+     * independently, with its own convergence metrics.
+     */
     Input<Buffer<float, 3>> input{"input"};
 
     /** Initial estimate of the restored image. */
     Input<Buffer<float, 3>> v{"v"};
 
-    // TODO(Antony): How do we determine the number of inputs z_i at run time? Generator::configure() ?
-    // Does Buffer<Func[2]> results in terse code? How to set dimensions?
-    Input<Buffer<float, 4>> z0{"z0"};
-    Input<Buffer<float, 3>> z1{"z1"};
-
-    Input<Buffer<float, 4>> u0{"u0"};
-    Input<Buffer<float, 3>> u1{"u1"};
-
     /** Problem scaling factor.
      *
-     * This influences the convergence rate of the (L-)ADMM algorithm.
+     * This influences the convergence rate of the (L-)ADMM algorithm. Set at
+     * run time, so that the solver can re-balance the primal and dual
+     * residuals. Converges when mu <= lmb / || K ||^2 .
      */
-    GeneratorParam<float> lmb{"lmb", 1.0f, 0.0f, 1e3f};
-    GeneratorParam<float> mu{"mu", 1.0f, 0.0f, 1e3f};
+    Input<float> lmb{"lmb", 1.0f, 1e-5f, 1e5f};
+    Input<float> mu{"mu", 1.0f, 1e-5f, 1e5f};
 
     /** Number of (L-)ADMM iterations before computing convergence metrics.
      *
@@ -38,134 +55,267 @@ class LinearizedADMMIter : public Generator<LinearizedADMMIter> {
      */
     GeneratorParam<uint32_t> n_iter{"n_iter", 1ul, 1ul, 500ul};
 
+    /** Determine the image width and height at run time.
+     *
+     * When false, the pipeline only accepts the image size defined in
+     * problem_config. When true, the pipeline accepts any image size, with
+     * specialized fast paths for the common sizes.
+     */
+    GeneratorParam<bool> dynamic_size{"dynamic_size", false};
+
+    /** Update policy of the iterations.
+     *
+     * "over_relaxed" speeds up the convergence with the relaxation parameter
+     * alpha. "accelerated" extrapolates z_i, u_i of the first iteration with
+     * the momentum computed at run time, and takes the previous z_i, u_i as
+     * additional inputs.
+     */
+    GeneratorParam<Update> update{"update",
+                                  Update::plain,
+                                  {{"plain", Update::plain},
+                                   {"over_relaxed", Update::over_relaxed},
+                                   {"accelerated", Update::accelerated}}};
+
+    /** Relaxation parameter of the over-relaxed update. */
+    GeneratorParam<float> alpha{"alpha", 1.5f, 1.0f, 2.0f};
+
     /** Optimal solution, after a hard termination after iterating for n_iter
      * times. */
     Output<Buffer<float, 3>> v_new{"v_new"};
 
-    // TODO(Antony): How do we figure out the number of outputs z_i at run time? configure() ?
-    Output<Buffer<float, 4>> z0_new{"z0_new"};
-    Output<Buffer<float, 3>> z1_new{"z1_new"};
+    // Convergence metrics, one per image in the batch.
+    Output<Buffer<float, 1>> r{"r"};  //!< Primal residual
+    Output<Buffer<float, 1>> s{"s"};  //!< Dual residual
+    Output<Buffer<float, 1>> eps_pri{"eps_pri"};
+    Output<Buffer<float, 1>> eps_dual{"eps_dual"};
+
+    // Split variables z_i, and scaled dual variables u_i, one per psi_fns.
+    InputBuffers z{};
+    InputBuffers u{};
+    OutputBuffers z_new{};
+    OutputBuffers u_new{};
+
+    // Accelerated update only: the momentum, and z_i, u_i of the previous iteration.
+    Input<float>* momentum = nullptr;
+    InputBuffers z_prev_in{};
+    InputBuffers u_prev_in{};
+
+    void configure() {
+        using problem_definition::psi_fns;
+
+        const auto addInputs = [&](InputBuffers& buffers, const std::string& name) {
+            for (size_t i = 0; i < N; i++) {
+                user_assert(psi_fns[i].n_dim == problem_config::psi_n_dim[i])
+                    << "problem_config::psi_n_dim does not match psi_fns.";
+                buffers[i] = add_input<Buffer<float>>(name + std::to_string(i), psi_fns[i].n_dim);
+            }
+        };
+
+        addInputs(z, "z");
+        addInputs(u, "u");
 
-    Output<Buffer<float, 4>> u0_new{"u0_new"};
-    Output<Buffer<float, 3>> u1_new{"u1_new"};
+        if (update == Update::accelerated) {
+            momentum = add_input<float>("momentum");
+            addInputs(z_prev_in, "z_prev");
+            addInputs(u_prev_in, "u_prev");
+        }
+
+        const auto addOutputs = [&](OutputBuffers& buffers, const std::string& name) {
+            for (size_t i = 0; i < N; i++) {
+                buffers[i] = add_output<Buffer<float>>(name + std::to_string(i) + "_new",
+                                                        psi_fns[i].n_dim);
+            }
+        };
 
-    // Convergence metrics
-    Output<float> r{"r"};  //!< Primal residual
-    Output<float> s{"s"};  //!< Dual residual
-    Output<float> eps_pri{"eps_pri"};
-    Output<float> eps_dual{"eps_dual"};
+        addOutputs(z_new, "z");
+        addOutputs(u_new, "u");
+    }
 
     void generate() {
-        using problem_config::psi_size;
         using problem_definition::K;
         using problem_definition::omega_fn;
         using problem_definition::psi_fns;
 
-        // How to generalize z_i as inputs?
-        static_assert(psi_size == 2);
-
         std::vector<Func> v_list(n_iter);
 
-        std::vector<FuncTuple<psi_size>> z_list(n_iter);
-        std::vector<FuncTuple<psi_size>> u_list(n_iter);
+        std::vector<FuncTuple<N>> z_list(n_iter);
+        std::vector<FuncTuple<N>> u_list(n_iter);
+
+        // Forward product K v of the last iteration, re-used by the convergence check.
+        FuncTuple<N> Kv;
 
-        using problem_config::input_height;
-        using problem_config::input_size;
-        using problem_config::input_width;
-        using problem_config::output_height;
-        using problem_config::output_size;
-        using problem_config::output_width;
+        // The restored image has the same size as the input image.
+        const Expr width = imageWidth();
+        const Expr height = imageHeight();
+        K.width = width;
+        K.height = height;
 
-        const RDom input_dimensions{0, input_width, 0, input_height, 0, 1};
-        const RDom output_dimensions{0, output_width, 0, output_height, 0, 1, 0, 2};
+        const Expr input_size = width * height;
+        const Expr output_size = width * height;
+
+        // Reduce over each image, but not across the batch.
+        const RDom output_dimensions{0, width, 0, height, 0, problem_config::psi_k_extent};
 
         for (size_t i = 0; i < n_iter; i++) {
             const Func& v_prev =
                 (i == 0) ? v : v_list[i - 1];
-            const FuncTuple<psi_size>& z_prev =
-                (i == 0) ? FuncTuple<psi_size>{z0, z1} : z_list[i - 1];
-            const FuncTuple<psi_size>& u_prev =
-                (i == 0) ? FuncTuple<psi_size>{u0, u1} : u_list[i - 1];
-
-            std::tie(v_list[i], z_list[i], u_list[i]) = algorithm::linearized_admm::iterate(
-                v_prev, z_prev, u_prev, K, omega_fn, psi_fns, lmb, mu, input);
+            const FuncTuple<N>& z_prev =
+                (i == 0) ? toFuncTuple(z) : z_list[i - 1];
+            const FuncTuple<N>& u_prev =
+                (i == 0) ? toFuncTuple(u) : u_list[i - 1];
+
+            using namespace algorithm::linearized_admm;
+            if (update == Update::over_relaxed) {
+                std::tie(v_list[i], z_list[i], u_list[i], Kv) =
+                    iterate(v_prev, z_prev, u_prev, K, omega_fn, psi_fns, lmb, mu, input,
+                            policy::OverRelaxed{alpha});
+            } else if (update == Update::accelerated && i == 0) {
+                const policy::Accelerated<N> accelerated{*momentum, toFuncTuple(z_prev_in),
+                                                         toFuncTuple(u_prev_in)};
+                std::tie(v_list[i], z_list[i], u_list[i], Kv) = iterate(
+                    v_prev, z_prev, u_prev, K, omega_fn, psi_fns, lmb, mu, input, accelerated);
+            } else {
+                std::tie(v_list[i], z_list[i], u_list[i], Kv) =
+                    iterate(v_prev, z_prev, u_prev, K, omega_fn, psi_fns, lmb, mu, input);
+            }
         }
 
-        const auto& z_prev = (n_iter > 1) ? *(z_list.rbegin() + 1) : FuncTuple<psi_size>{z0, z1};
+        const auto& z_prev = (n_iter > 1) ? *(z_list.rbegin() + 1) : toFuncTuple(z);
+        // The auto-scheduler requires the norms to be left unscheduled.
         const auto [_r, _s, _eps_pri, _eps_dual] = algorithm::linearized_admm::computeConvergence(
-            v_list.back(), z_list.back(), u_list.back(), z_prev, K, lmb, input_size,
-            input_dimensions, output_size,
-            output_dimensions);
+            Kv, z_list.back(), u_list.back(), z_prev, K, lmb, input_size, output_size,
+            output_dimensions, 1e-3f, 1e-3f, !using_autoscheduler());
 
         // Export data
         v_new = v_list.back();
-        std::tie(z0_new, z1_new) = std::make_pair(z_list.back()[0], z_list.back()[1]);
-        std::tie(u0_new, u1_new) = std::make_pair(u_list.back()[0], u_list.back()[1]);
-        r() = _r;
-        s() = _s;
-        eps_pri() = _eps_pri;
-        eps_dual() = _eps_dual;
+        for (size_t i = 0; i < N; i++) {
+            *z_new[i] = z_list.back()[i];
+            *u_new[i] = u_list.back()[i];
+        }
+        r(c) = _r;
+        s(c) = _s;
+        eps_pri(c) = _eps_pri;
+        eps_dual(c) = _eps_dual;
     }
 
-    /** Inform Halide of the fixed input and output image sizes. */
+    /** Image width, either fixed at compile time, or determined by the input buffer. */
+    Expr imageWidth() { return dynamic_size ? input.dim(0).extent() : Expr(W); }
+
+    /** Image height, either fixed at compile time, or determined by the input buffer. */
+    Expr imageHeight() { return dynamic_size ? input.dim(1).extent() : Expr(H); }
+
+    /** Inform Halide of the input and output image sizes.
+     *
+     * The batch size is determined at run time. All buffers must hold the same
+     * number of images, of the same width and height.
+     */
     void setBounds() {
-        for (auto* a : {&input, &v, &z1, &u1}) {
-            a->dim(0).set_bounds(0, W);
-            a->dim(1).set_bounds(0, H);
-            a->dim(2).set_bounds(0, 1);
+        input.dim(0).set_min(0);
+        input.dim(1).set_min(0);
+        input.dim(2).set_min(0);
+
+        if (!dynamic_size) {
+            input.dim(0).set_extent(W);
+            input.dim(1).set_extent(H);
         }
 
-        for (auto* a : {&z0, &u0}) {
-            a->dim(0).set_bounds(0, W);
-            a->dim(1).set_bounds(0, H);
-            a->dim(2).set_bounds(0, 1);
-            a->dim(3).set_bounds(0, 2);
+        const Expr width = imageWidth();
+        const Expr height = imageHeight();
+        const Expr batch_size = input.dim(2).extent();
+
+        const auto setImageBounds = [&](auto* a) {
+            a->dim(0).set_bounds(0, width);
+            a->dim(1).set_bounds(0, height);
+            a->dim(2).set_bounds(0, batch_size);
+
+            if (a->dimensions() == 4) {
+                a->dim(3).set_bounds(0, problem_config::psi_k_extent);
+            }
+        };
+
+        setImageBounds(&v);
+        setImageBounds(&v_new);
+
+        for (auto* a : inputBuffers()) {
+            setImageBounds(a);
         }
 
-        for (auto* a : {&v_new, &z1_new, &u1_new}) {
-            a->dim(0).set_bounds(0, W);
-            a->dim(1).set_bounds(0, H);
-            a->dim(2).set_bounds(0, 1);
+        for (auto* a : outputBuffers()) {
+            setImageBounds(a);
         }
 
-        for (auto* a : {&z0_new, &u0_new}) {
-            a->dim(0).set_bounds(0, W);
-            a->dim(1).set_bounds(0, H);
-            a->dim(2).set_bounds(0, 1);
-            a->dim(3).set_bounds(0, 2);
+        for (auto* a : {&r, &s, &eps_pri, &eps_dual}) {
+            a->dim(0).set_bounds(0, batch_size);
         }
     }
 
     void scheduleForCPU() {
+        // Images in a batch are independent; iterate over them in the outermost loop.
         const auto vec_width = natural_vector_size<float>();
-        v_new.reorder(c, x, y).vectorize(x, vec_width).parallel(y);
-        u0_new.reorder(c, k, x, y).vectorize(x, vec_width).parallel(y).unroll(k, 2);
-        z0_new.reorder(c, k, x, y).vectorize(x, vec_width).parallel(y).unroll(k, 2);
+        v_new.reorder(x, y, c).vectorize(x, vec_width).parallel(y);
+
+        for (auto* a : outputBuffers()) {
+            if (a->dimensions() == 4) {
+                a->reorder(k, x, y, c)
+                    .vectorize(x, vec_width)
+                    .parallel(y)
+                    .unroll(k, problem_config::psi_k_extent);
+            } else {
+                a->reorder(x, y, c).vectorize(x, vec_width).parallel(y);
+            }
+        }
+
+        if (!dynamic_size) {
+            return;
+        }
+
+        // Fast paths for the common square image sizes. The specializations
+        // inherit the schedule above, but with compile-time constant bounds.
+        for (const int size : {512, 1024, 2048}) {
+            const Expr is_common_size =
+                (input.dim(0).extent() == size) && (input.dim(1).extent() == size);
 
-        u1_new.reorder(c, x, y).vectorize(x, vec_width).parallel(y);
-        z1_new.reorder(c, x, y).vectorize(x, vec_width).parallel(y);
+            Func(v_new).specialize(is_common_size);
+            for (auto* a : outputBuffers()) {
+                Func(*a).specialize(is_common_size);
+            }
+        }
     }
 
     void schedule() {
         setBounds();
 
         if (using_autoscheduler()) {
+            const auto setImageEstimates = [](auto* a) {
+                if (a->dimensions() == 4) {
+                    a->set_estimates({{0, W}, {0, H}, {0, 1}, {0, problem_config::psi_k_extent}});
+                } else {
+                    a->set_estimates({{0, W}, {0, H}, {0, 1}});
+                }
+            };
+
             // Estimate the image sizes of the inputs.
-            for (auto* a : {&input, &v, &z1, &u1}) {
-                a->set_estimates({{0, W}, {0, H}, {0, 1}});
+            setImageEstimates(&input);
+            setImageEstimates(&v);
+            for (auto* a : inputBuffers()) {
+                setImageEstimates(a);
             }
 
-            for (auto* a : {&z0, &u0}) {
-                a->set_estimates({{0, W}, {0, H}, {0, 1}, {0, 2}});
+            // Estimate the image sizes of the outputs.
+            setImageEstimates(&v_new);
+            for (auto* a : outputBuffers()) {
+                setImageEstimates(a);
             }
 
-            // Estimate the image sizes of the outputs.
-            for (auto* a : {&v_new, &z1_new, &u1_new}) {
-                a->set_estimates({{0, W}, {0, H}, {0, 1}});
+            for (auto* a : {&r, &s, &eps_pri, &eps_dual}) {
+                a->set_estimates({{0, 1}});
             }
 
-            for (auto* a : {&z0_new, &u0_new}) {
-                a->set_estimates({{0, W}, {0, H}, {0, 1}, {0, 2}});
+            lmb.set_estimate(1.0f);
+            mu.set_estimate(0.11111f);
+
+            if (update == Update::accelerated) {
+                momentum->set_estimate(0.0f);
             }
             return;
         }
@@ -173,6 +323,34 @@ class LinearizedADMMIter : public Generator<LinearizedADMMIter> {
         // Schedule for CPU
         return scheduleForCPU();
     }
+
+   private:
+    static FuncTuple<N> toFuncTuple(const InputBuffers& buffers) {
+        FuncTuple<N> funcs;
+        for (size_t i = 0; i < N; i++) {
+            funcs[i] = *buffers[i];
+        }
+        return funcs;
+    }
+
+    /** The z_i, u_i inputs created in configure(). */
+    std::vector<Input<Buffer<float>>*> inputBuffers() const {
+        std::vector<Input<Buffer<float>>*> buffers{z.begin(), z.end()};
+        buffers.insert(buffers.end(), u.begin(), u.end());
+
+        if (update == Update::accelerated) {
+            buffers.insert(buffers.end(), z_prev_in.begin(), z_prev_in.end());
+            buffers.insert(buffers.end(), u_prev_in.begin(), u_prev_in.end());
+        }
+        return buffers;
+    }
+
+    /** The z_i, u_i outputs created in configure(). */
+    std::vector<Output<Buffer<float>>*> outputBuffers() const {
+        std::vector<Output<Buffer<float>>*> buffers{z_new.begin(), z_new.end()};
+        buffers.insert(buffers.end(), u_new.begin(), u_new.end());
+        return buffers;
+    }
 };
 
 HALIDE_REGISTER_GENERATOR(LinearizedADMMIter, ladmm_iter);
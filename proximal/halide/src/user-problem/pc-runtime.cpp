@@ -0,0 +1,107 @@
+#include "pc-runtime.h"
+
+#include <HalideBuffer.h>
+
+#include <cassert>
+#include <chrono>
+#include <vector>
+
+#include "pc_iter.h"
+#include "pipeline-args.h"
+#include "problem-config.h"
+
+using Halide::Runtime::Buffer;
+
+namespace proximal {
+namespace runtime {
+
+constexpr auto W = problem_config::input_width;
+constexpr auto H = problem_config::input_height;
+
+signals_t
+pcSolver(Buffer<const float>& input, const size_t iter_max) {
+    assert(input.dim(0).extent() == W);
+    assert(input.dim(1).extent() == H);
+    const auto start = std::chrono::steady_clock::now();
+
+    // Batch of one image.
+    Buffer<float> X(W, H, 1);
+    Buffer<float> Xbar(W, H, 1);
+    Buffer<float> X_new(W, H, 1);
+    Buffer<float> Xbar_new(W, H, 1);
+
+    // One y_i per psi_fns, either 3D or 4D.
+    std::vector<Buffer<float>> Y;
+    std::vector<Buffer<float>> Y_new;
+    for (const int n_dim : problem_config::psi_n_dim) {
+        const auto shape = (n_dim == 4) ? std::vector<int>{W, H, 1, problem_config::psi_k_extent}
+                                        : std::vector<int>{W, H, 1};
+
+        for (auto* p : {&Y, &Y_new}) {
+            p->emplace_back(shape);
+        }
+    }
+
+    // Set zeros
+    for (auto* buf : {&X, &Xbar}) {
+        buf->fill(0.0f);
+        buf->set_host_dirty();
+    }
+    for (auto& buf : Y) {
+        buf.fill(0.0f);
+        buf.set_host_dirty();
+    }
+
+    std::vector<float> r(iter_max);
+    std::vector<float> s(iter_max);
+    std::vector<float> eps_pri(iter_max);
+    std::vector<float> eps_dual(iter_max);
+
+    for (size_t i = 0; i < iter_max; i++) {
+        Buffer<float> _r(r.data() + i, 1);
+        Buffer<float> _s(s.data() + i, 1);
+        Buffer<float> _eps_pri(eps_pri.data() + i, 1);
+        Buffer<float> _eps_dual(eps_dual.data() + i, 1);
+
+        PipelineArgs args;
+        args << input << X << Xbar << Y << X_new << Xbar_new << _r << _s << _eps_pri << _eps_dual
+             << Y_new;
+
+        const auto error = args.call(pc_iter_argv);
+
+        if (error) {
+            return {error, {}, {}, {}, {}, {}};
+        }
+
+        // Terminate the algorithm early, if optimal solution is reached.
+        for (auto* p : {&_r, &_s, &_eps_pri, &_eps_dual}) {
+            p->copy_to_host();
+        }
+
+        const bool converged = (r[i] < eps_pri[i]) && (s[i] < eps_dual[i]);
+        if (converged) {
+            for (auto* v : {&r, &s, &eps_pri, &eps_dual}) {
+                v->resize(i + 1);
+            }
+            break;
+        }
+
+        if (i != iter_max - 1) {
+            // This iteration's X_new becomes current X in the next iteration.
+            std::swap(X, X_new);
+            std::swap(Xbar, Xbar_new);
+            std::swap(Y, Y_new);
+        }
+    }
+
+    X_new.copy_to_host();
+
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    constexpr int success = 0;
+    return {success, X_new, r, s, eps_pri, eps_dual, r.size(), elapsed.count()};
+}
+
+}  // namespace runtime
+
+}  // namespace proximal
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <HalideBuffer.h>
+
+#include "signals.h"
+
+namespace proximal {
+namespace runtime {
+
+/** Runtime function to call Pock-Chambolle, with early termination.
+ *
+ * Same as ladmmSolver(), except that the Halide-optimized AOT pipeline
+ * iterates the primal-dual algorithm of Chambolle and Pock (2011). The
+ * returned signals_t::v_new is the primal variable X.
+ *
+ * The tolerances eps_abs = eps_rel = 1e-3 of the convergence criteria are
+ * compiled into the pipeline. Only the image size defined in problem_config is
+ * supported.
+ */
+signals_t pcSolver(Buffer<const float>& input, const size_t iter_max = 100);
+
+}  // namespace runtime
+
+}  // namespace proximal
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <HalideBuffer.h>
+
+#include <deque>
+#include <vector>
+
+namespace proximal {
+namespace runtime {
+
+using Halide::Runtime::Buffer;
+
+/** The argv entry point of a Halide AOT pipeline, e.g. ladmm_iter_argv(). */
+using pipeline_argv_t = int (*)(void**);
+
+/** Arguments of a Halide pipeline called through its argv entry point.
+ *
+ * The generators create one z_i, u_i per psi_fns in configure(), so the
+ * pipeline signature depends on problem_config::psi_size. Append the arguments
+ * in the order documented in the generator.
+ *
+ * The buffers passed as lvalues are referenced, so that the Halide runtime
+ * updates their host/device dirty flags; the temporary buffers, e.g. crops,
+ * are kept alive until the call.
+ */
+class PipelineArgs {
+   public:
+    PipelineArgs& operator<<(Buffer<const float>& buf) {
+        args.push_back(buf.raw_buffer());
+        return *this;
+    }
+
+    PipelineArgs& operator<<(Buffer<float>& buf) {
+        args.push_back(buf.raw_buffer());
+        return *this;
+    }
+
+    PipelineArgs& operator<<(Buffer<float>&& buf) {
+        owned.push_back(std::move(buf));
+        return *this << owned.back();
+    }
+
+    PipelineArgs& operator<<(std::vector<Buffer<float>>& bufs) {
+        for (auto& buf : bufs) {
+            *this << buf;
+        }
+        return *this;
+    }
+
+    PipelineArgs& operator<<(float& scalar) {
+        args.push_back(&scalar);
+        return *this;
+    }
+
+    int call(const pipeline_argv_t pipeline) { return pipeline(args.data()); }
+
+   private:
+    std::vector<void*> args;
+    std::deque<Buffer<float>> owned;
+};
+
+}  // namespace runtime
+
+}  // namespace proximal
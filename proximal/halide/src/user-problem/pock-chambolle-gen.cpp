@@ -0,0 +1,211 @@
+#include <Halide.h>
+using namespace Halide;
+
+#include "pock-chambolle.h"
+#include "problem-definition.h"
+
+/** Halide-optimized Pock-Chambolle iterations for the problem in problem_definition.
+ *
+ * The dual variables y_i are created in configure(), one per function in
+ * psi_fns. The generated pipeline takes the arguments in the following order:
+ *
+ *     input, X, Xbar, y0 ... y{N-1},
+ *     X_new, Xbar_new, r, s, eps_pri, eps_dual, y0_new ... y{N-1}_new
+ */
+class PockChambolleIter : public Generator<PockChambolleIter> {
+    static constexpr auto W = problem_config::output_width;
+    static constexpr auto H = problem_config::output_height;
+    static constexpr auto N = problem_config::psi_size;
+
+    using InputBuffers = std::array<Input<Buffer<float>>*, N>;
+    using OutputBuffers = std::array<Output<Buffer<float>>*, N>;
+
+   public:
+    /** User-provided distorted, and noisy images.
+     *
+     * The third dimension indexes the images in a batch. Each image is solved
+     * independently, with its own convergence metrics.
+     */
+    Input<Buffer<float, 3>> input{"input"};
+
+    /** Initial estimate of the restored image, and its extrapolation. */
+    Input<Buffer<float, 3>> X{"X"};
+    Input<Buffer<float, 3>> Xbar{"Xbar"};
+
+    /** Dual and primal step sizes.
+     *
+     * The algorithm converges when sigma * tau * || K ||^2 < 1.
+     */
+    GeneratorParam<float> sigma{"sigma", 1.0f, 0.0f, 1e3f};
+    GeneratorParam<float> tau{"tau", 1.0f, 0.0f, 1e3f};
+
+    /** Number of Pock-Chambolle iterations before computing convergence metrics. */
+    GeneratorParam<uint32_t> n_iter{"n_iter", 1ul, 1ul, 500ul};
+
+    /** Optimal solution, after a hard termination after iterating for n_iter
+     * times. */
+    Output<Buffer<float, 3>> X_new{"X_new"};
+    Output<Buffer<float, 3>> Xbar_new{"Xbar_new"};
+
+    // Convergence metrics, one per image in the batch.
+    Output<Buffer<float, 1>> r{"r"};  //!< Primal residual
+    Output<Buffer<float, 1>> s{"s"};  //!< Dual residual
+    Output<Buffer<float, 1>> eps_pri{"eps_pri"};
+    Output<Buffer<float, 1>> eps_dual{"eps_dual"};
+
+    // Dual variables y_i, one per psi_fns.
+    InputBuffers Y{};
+    OutputBuffers Y_new{};
+
+    void configure() {
+        using problem_definition::psi_fns;
+
+        for (size_t i = 0; i < N; i++) {
+            user_assert(psi_fns[i].n_dim == problem_config::psi_n_dim[i])
+                << "problem_config::psi_n_dim does not match psi_fns.";
+
+            const auto n_dim = psi_fns[i].n_dim;
+            const auto index = std::to_string(i);
+            Y[i] = add_input<Buffer<float>>("y" + index, n_dim);
+            Y_new[i] = add_output<Buffer<float>>("y" + index + "_new", n_dim);
+        }
+    }
+
+    void generate() {
+        using problem_definition::K;
+        using problem_definition::omega_fn;
+        using problem_definition::psi_fns;
+
+        std::vector<Func> X_list(n_iter);
+        std::vector<Func> Xbar_list(n_iter);
+        std::vector<FuncTuple<N>> Y_list(n_iter);
+
+        const Expr input_size = W * H;
+        const Expr output_size = W * H;
+
+        // Reduce over each image, but not across the batch.
+        const RDom input_dimensions{0, W, 0, H};
+
+        for (size_t i = 0; i < n_iter; i++) {
+            const Func& X_prev = (i == 0) ? X : X_list[i - 1];
+            const Func& Xbar_prev = (i == 0) ? Xbar : Xbar_list[i - 1];
+            const FuncTuple<N>& Y_prev = (i == 0) ? toFuncTuple(Y) : Y_list[i - 1];
+
+            std::tie(X_list[i], Xbar_list[i], Y_list[i]) = algorithm::pock_chambolle::iterate(
+                X_prev, Xbar_prev, Y_prev, K, omega_fn, psi_fns, sigma, tau, input);
+        }
+
+        const Func& X_prev = (n_iter > 1) ? *(X_list.rbegin() + 1) : Func(X);
+        const auto& Y_prev = (n_iter > 1) ? *(Y_list.rbegin() + 1) : toFuncTuple(Y);
+        const auto [_r, _s, _eps_pri, _eps_dual] = algorithm::pock_chambolle::computeConvergence(
+            X_list.back(), X_prev, Y_list.back(), Y_prev, K, input_size, input_dimensions,
+            output_size);
+
+        // Export data
+        X_new = X_list.back();
+        Xbar_new = Xbar_list.back();
+        for (size_t i = 0; i < N; i++) {
+            *Y_new[i] = Y_list.back()[i];
+        }
+        r(c) = _r;
+        s(c) = _s;
+        eps_pri(c) = _eps_pri;
+        eps_dual(c) = _eps_dual;
+    }
+
+    /** Inform Halide of the input and output image sizes.
+     *
+     * The batch size is determined at run time. All buffers must hold the same
+     * number of images.
+     */
+    void setBounds() {
+        input.dim(0).set_bounds(0, W);
+        input.dim(1).set_bounds(0, H);
+        input.dim(2).set_min(0);
+
+        const Expr batch_size = input.dim(2).extent();
+
+        const auto setImageBounds = [&](auto* a) {
+            a->dim(0).set_bounds(0, W);
+            a->dim(1).set_bounds(0, H);
+            a->dim(2).set_bounds(0, batch_size);
+
+            if (a->dimensions() == 4) {
+                a->dim(3).set_bounds(0, problem_config::psi_k_extent);
+            }
+        };
+
+        setImageBounds(&X);
+        setImageBounds(&Xbar);
+        setImageBounds(&X_new);
+        setImageBounds(&Xbar_new);
+        for (size_t i = 0; i < N; i++) {
+            setImageBounds(Y[i]);
+            setImageBounds(Y_new[i]);
+        }
+
+        for (auto* a : {&r, &s, &eps_pri, &eps_dual}) {
+            a->dim(0).set_bounds(0, batch_size);
+        }
+    }
+
+    void schedule() {
+        setBounds();
+
+        if (using_autoscheduler()) {
+            // Estimate the image sizes of the inputs.
+            for (auto* a : {&input, &X, &Xbar}) {
+                a->set_estimates({{0, W}, {0, H}, {0, 1}});
+            }
+
+            // Estimate the image sizes of the outputs.
+            for (auto* a : {&X_new, &Xbar_new}) {
+                a->set_estimates({{0, W}, {0, H}, {0, 1}});
+            }
+
+            const auto setDualEstimates = [&](auto* a) {
+                if (a->dimensions() == 4) {
+                    a->set_estimates(
+                        {{0, W}, {0, H}, {0, 1}, {0, problem_config::psi_k_extent}});
+                } else {
+                    a->set_estimates({{0, W}, {0, H}, {0, 1}});
+                }
+            };
+            for (size_t i = 0; i < N; i++) {
+                setDualEstimates(Y[i]);
+                setDualEstimates(Y_new[i]);
+            }
+
+            for (auto* a : {&r, &s, &eps_pri, &eps_dual}) {
+                a->set_estimates({{0, 1}});
+            }
+            return;
+        }
+
+        // Schedule for CPU
+        const auto vec_width = natural_vector_size<float>();
+        X_new.reorder(x, y, c).vectorize(x, vec_width).parallel(y);
+        Xbar_new.reorder(x, y, c).vectorize(x, vec_width).parallel(y);
+        for (auto* a : Y_new) {
+            if (a->dimensions() == 4) {
+                a->reorder(k, x, y, c)
+                    .vectorize(x, vec_width)
+                    .parallel(y)
+                    .unroll(k, problem_config::psi_k_extent);
+            } else {
+                a->reorder(x, y, c).vectorize(x, vec_width).parallel(y);
+            }
+        }
+    }
+
+   private:
+    static FuncTuple<N> toFuncTuple(const InputBuffers& buffers) {
+        FuncTuple<N> funcs;
+        for (size_t i = 0; i < N; i++) {
+            funcs[i] = *buffers[i];
+        }
+        return funcs;
+    }
+};
+
+HALIDE_REGISTER_GENERATOR(PockChambolleIter, pc_iter);
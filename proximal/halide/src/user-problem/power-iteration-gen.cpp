@@ -0,0 +1,77 @@
+#include <Halide.h>
+using namespace Halide;
+
+#include "power-iteration.h"
+#include "problem-definition.h"
+
+class PowerIteration : public Generator<PowerIteration> {
+   public:
+    /** Current estimate of the dominant eigenvector of K^T K, of unit norm.
+     *
+     * The image size is determined at run time.
+     */
+    Input<Buffer<float, 3>> v{"v"};
+
+    /** Number of power iterations per pipeline invocation. */
+    GeneratorParam<uint32_t> n_iter{"n_iter", 10ul, 1ul, 100ul};
+
+    /** Next estimate of the dominant eigenvector, of unit norm. */
+    Output<Buffer<float, 3>> v_new{"v_new"};
+
+    /** Estimate of the largest eigenvalue of K^T K, i.e. || K ||^2, one per image in the batch. */
+    Output<Buffer<float, 1>> norm{"norm"};
+
+    void generate() {
+        using problem_config::psi_size;
+        using problem_definition::K;
+
+        const Expr width = v.dim(0).extent();
+        const Expr height = v.dim(1).extent();
+        K.width = width;
+        K.height = height;
+
+        const RDom input_dimensions{0, width, 0, height};
+
+        v_list.resize(n_iter);
+        norm_list.resize(n_iter);
+        for (size_t i = 0; i < n_iter; i++) {
+            const Func& v_prev = (i == 0) ? v : v_list[i - 1];
+            std::tie(v_list[i], norm_list[i]) =
+                algorithm::power_iteration::iterate<psi_size>(v_prev, K, input_dimensions);
+        }
+
+        // Export data
+        v_new = v_list.back();
+        norm(c) = norm_list.back()(c);
+    }
+
+    void schedule() {
+        v.dim(0).set_min(0);
+        v.dim(1).set_min(0);
+        v.dim(2).set_min(0);
+
+        const Expr batch_size = v.dim(2).extent();
+        v_new.dim(0).set_bounds(0, v.dim(0).extent());
+        v_new.dim(1).set_bounds(0, v.dim(1).extent());
+        v_new.dim(2).set_bounds(0, batch_size);
+        norm.dim(0).set_bounds(0, batch_size);
+
+        // Each iteration reads the whole image twice: to compute the norm, and
+        // then to normalize. Store the intermediate results.
+        const auto vec_width = natural_vector_size<float>();
+        for (size_t i = 0; i < n_iter; i++) {
+            norm_list[i].compute_root();
+            if (i + 1 < n_iter) {
+                v_list[i].compute_root().vectorize(x, vec_width).parallel(y);
+            }
+        }
+
+        v_new.vectorize(x, vec_width).parallel(y);
+    }
+
+   private:
+    std::vector<Func> v_list;
+    std::vector<Func> norm_list;
+};
+
+HALIDE_REGISTER_GENERATOR(PowerIteration, power_iter);
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <array>
+
 /** User-defined problem configurations. This is supposed to be generated automatically by
  * ProxImal-Gen */
 namespace problem_config {
@@ -7,6 +9,12 @@ namespace problem_config {
 /** Number of functions in the set "psi", for (L-)ADMM solvers. */
 constexpr auto psi_size = 2;
 
+/** Number of dimensions of each z_i: either 3 (x, y, c), or 4 (x, y, c, k). */
+constexpr std::array<int, psi_size> psi_n_dim{4, 3};
+
+/** Extent of the 4th dimension k of the 4D z_i, e.g. dx, dy of the image gradient. */
+constexpr auto psi_k_extent = 2;
+
 /** input data size of the user-provided (distorted and noisy) image. */
 constexpr auto input_width = 512;
 constexpr auto input_height = 512;
@@ -27,10 +27,13 @@ using proximal::prox::ParameterizedProx;
  * an example.
  */
 struct Transform {
-    constexpr static auto width = problem_config::output_width;
-    constexpr static auto height = problem_config::output_height;
     constexpr static auto N = problem_config::psi_size;
 
+    /** Image dimensions. The generator overrides them with the input buffer
+     * dimensions, when the image size is only known at run time. */
+    Expr width = problem_config::output_width;
+    Expr height = problem_config::output_height;
+
     /** Compute dx, dy of a two dimensional image with c number of channels. */
     FuncTuple<N> forward(const Func& z) {
         /* Begin code-generation */
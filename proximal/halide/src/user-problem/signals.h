@@ -0,0 +1,35 @@
+#pragma once
+
+#include <HalideBuffer.h>
+
+#include <cstddef>
+#include <vector>
+
+namespace proximal {
+namespace runtime {
+
+using Halide::Runtime::Buffer;
+
+/** Restored image and convergence metrics returned by the solvers.
+ *
+ * The metrics are recorded once per convergence check, which may be several
+ * iterations apart.
+ */
+struct signals_t {
+    int error_code;
+    Buffer<float> v_new;
+    std::vector<float> r;
+    std::vector<float> s;
+    std::vector<float> eps_pri;
+    std::vector<float> eps_dual;
+
+    /** Total number of iterations. */
+    size_t n_iter = 0;
+
+    /** Wall time to convergence, or to iter_max, in seconds. */
+    double elapsed = 0.0;
+};
+
+}  // namespace runtime
+
+}  // namespace proximal
@@ -0,0 +1,78 @@
+#include <HalideBuffer.h>
+#include <HalideRuntime.h>
+
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <thread>
+
+#include "ladmm-runtime.h"
+#include "problem-config.h"
+
+using Halide::Runtime::Buffer;
+using proximal::runtime::ladmmSolver;
+using proximal::runtime::LadmmWorkspace;
+
+namespace {
+
+constexpr auto W = problem_config::input_width;
+constexpr auto H = problem_config::input_height;
+
+constexpr size_t n_iter = 20;
+
+/** Synthetic noisy image, so that the test does not depend on the image I/O libraries. */
+Buffer<float>
+noisyImage() {
+    std::mt19937 rng{42};
+    std::normal_distribution<float> noise{0.0f, 0.1f};
+
+    Buffer<float> img(W, H, 1);
+    img.for_each_element([&](int x, int y, int c) {
+        const float checkerboard = ((x / 32 + y / 32) % 2 == 0) ? 0.25f : 0.75f;
+        img(x, y, c) = checkerboard + noise(rng);
+    });
+    return img;
+}
+
+}  // namespace
+
+/** The convergence metrics of the L-ADMM are summed in a fixed order, see
+ * reduction::sum2D(). They must be bitwise identical for any number of
+ * threads, and so must be the number of iterations to convergence. */
+int
+main() {
+    Buffer<const float> input = noisyImage();
+
+    const int max_threads = std::max(1u, std::thread::hardware_concurrency());
+
+    halide_set_num_threads(1);
+    LadmmWorkspace workspace{n_iter};
+    const auto reference = ladmmSolver(input, workspace, n_iter);
+    if (reference.error_code != 0) {
+        std::cerr << "L-ADMM failed with error code " << reference.error_code << '\n';
+        return 1;
+    }
+
+    for (const int n_threads : {2, 3, max_threads}) {
+        halide_set_num_threads(n_threads);
+        const auto result = ladmmSolver(input, workspace, n_iter);
+        if (result.error_code != 0) {
+            std::cerr << "L-ADMM failed with error code " << result.error_code << '\n';
+            return 1;
+        }
+
+        const bool identical = (result.n_iter == reference.n_iter) && (result.r == reference.r) &&
+                               (result.s == reference.s) && (result.eps_pri == reference.eps_pri) &&
+                               (result.eps_dual == reference.eps_dual);
+
+        std::cout << n_threads << " threads: " << result.n_iter << " iterations, r = "
+                  << result.r.back() << ", s = " << result.s.back()
+                  << (identical ? "" : " (differs from 1 thread)") << '\n';
+
+        if (!identical) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,101 @@
+#include <HalideBuffer.h>
+
+#include <chrono>
+#include <iostream>
+#include <utility>
+
+#include "admm-runtime.h"
+#include "halide_image_io.h"
+#include "hqs-runtime.h"
+#include "ladmm-runtime.h"
+#include "pc-runtime.h"
+#include "problem-config.h"
+
+using Halide::Runtime::Buffer;
+using Halide::Tools::load_and_convert_image;
+using proximal::runtime::admmSolver;
+using proximal::runtime::hqsSolver;
+using proximal::runtime::ladmmSolver;
+using proximal::runtime::pcSolver;
+using proximal::runtime::signals_t;
+
+namespace {
+
+#ifndef RAW_IMAGE_PATH
+#error Path to the raw image must be defined with -DRAW_IMAGE_PATH="..." in the compile command.
+#endif
+
+constexpr char raw_image_path[]{RAW_IMAGE_PATH};
+
+/** Whether the residuals of the last convergence check are below the tolerances. */
+bool
+isConverged(const signals_t& result) {
+    return !result.r.empty() && (result.r.back() < result.eps_pri.back()) &&
+           (result.s.back() < result.eps_dual.back());
+}
+
+/** Run the solver, and then report the wall time to convergence. */
+template <typename F>
+signals_t
+timeToConvergence(const char* name, F&& solver) {
+    const auto start = std::chrono::steady_clock::now();
+    signals_t result = solver();
+    const auto stop = std::chrono::steady_clock::now();
+
+    const std::chrono::duration<double, std::milli> elapsed = stop - start;
+    const auto n_iter = result.n_iter;
+
+    std::cout << name << ": " << n_iter << " iterations, " << elapsed.count() << " ms"
+              << (isConverged(result) ? ", converged" : ", not converged") << '\n';
+    return result;
+}
+
+}  // namespace
+
+int
+main() {
+    Buffer<float> raw_image = load_and_convert_image(raw_image_path);
+
+    raw_image.add_dimension();
+    Buffer<const float> normalized = std::move(raw_image);
+
+    const auto max_n_iter = 100;
+
+    const auto ladmm =
+        timeToConvergence("L-ADMM", [&]() { return ladmmSolver(normalized, max_n_iter); });
+    const auto pc =
+        timeToConvergence("Pock-Chambolle", [&]() { return pcSolver(normalized, max_n_iter); });
+    const auto admm =
+        timeToConvergence("ADMM", [&]() { return admmSolver(normalized, max_n_iter); });
+
+    // Fast preview: a few inner iterations per rho.
+    const auto hqs = timeToConvergence("HQS", [&]() {
+        return hqsSolver(normalized, {/* .rho_0 = */ 1.0f, /* .rho_scale = */ 2.0f * 1.41421356f,
+                                      /* .rho_max = */ 256.0f, /* .max_outer_iters = */ 8,
+                                      /* .max_inner_iters = */ 3});
+    });
+
+    if (ladmm.error_code || pc.error_code || admm.error_code || hqs.error_code) {
+        std::cerr << "Halide pipeline error: " << ladmm.error_code << ", " << pc.error_code << ", "
+                  << admm.error_code << ", " << hqs.error_code << '\n';
+        return 1;
+    }
+
+    // The other solvers are timed for comparison only, e.g. the HQS preview
+    // stops early by design.
+    for (const auto& [result, name] : {std::make_pair(&ladmm, "L-ADMM"),
+                                       std::make_pair(&pc, "Pock-Chambolle")}) {
+        if (!isConverged(*result)) {
+            std::cerr << name << " did not converge in " << max_n_iter << " iterations\n";
+            return 1;
+        }
+    }
+
+    std::cout << "Top-left pixel (L-ADMM, Pock-Chambolle, ADMM) = " << ladmm.v_new(0, 0, 0)
+              << ", " << pc.v_new(0, 0, 0) << ", " << admm.v_new(0, 0, 0) << '\n';
+
+    Buffer<float> output = pc.v_new;
+    Halide::Tools::convert_and_save_image(output, "denoised-pc.png");
+
+    return 0;
+}
@@ -0,0 +1,106 @@
+#include <HalideBuffer.h>
+
+#include <iostream>
+#include <random>
+
+#include "ladmm-runtime.h"
+#include "problem-config.h"
+
+using Halide::Runtime::Buffer;
+using proximal::runtime::ladmmSolver;
+using proximal::runtime::ladmmSolverWarmStart;
+using proximal::runtime::LadmmWorkspace;
+using proximal::runtime::signals_t;
+
+namespace {
+
+constexpr auto W = problem_config::input_width;
+constexpr auto H = problem_config::input_height;
+
+constexpr size_t n_iter = 10;
+
+/** Synthetic noisy image, so that the test does not depend on the image I/O libraries. */
+Buffer<float>
+noisyImage() {
+    std::mt19937 rng{42};
+    std::normal_distribution<float> noise{0.0f, 0.1f};
+
+    Buffer<float> img(W, H, 1);
+    img.for_each_element([&](int x, int y, int c) {
+        const float checkerboard = ((x / 32 + y / 32) % 2 == 0) ? 0.25f : 0.75f;
+        img(x, y, c) = checkerboard + noise(rng);
+    });
+    return img;
+}
+
+bool
+isIdentical(const Buffer<float>& a, const Buffer<float>& b) {
+    bool identical = true;
+    a.for_each_element([&](int x, int y, int c) { identical &= (a(x, y, c) == b(x, y, c)); });
+    return identical;
+}
+
+bool
+failed(const char* name, const signals_t& result) {
+    if (result.error_code != 0) {
+        std::cerr << name << " failed with error code " << result.error_code << '\n';
+        return true;
+    }
+    return false;
+}
+
+}  // namespace
+
+/** A warm start with iter_max = 0 must return, and retain in the workspace,
+ * the estimates of the previous solve. The next warm start then resumes from
+ * them, as if the empty solve never happened. */
+int
+main() {
+    Buffer<const float> input = noisyImage();
+
+    // Reference: cold start, then warm start.
+    LadmmWorkspace reference_workspace{n_iter};
+    const auto reference_cold = ladmmSolver(input, reference_workspace, n_iter);
+    if (failed("Cold start", reference_cold)) {
+        return 1;
+    }
+    const auto reference = ladmmSolverWarmStart(input, reference_workspace, n_iter);
+    if (failed("Warm start", reference)) {
+        return 1;
+    }
+
+    // Cold start, empty warm start, then warm start.
+    LadmmWorkspace workspace{n_iter};
+    const auto cold = ladmmSolver(input, workspace, n_iter);
+    if (failed("Cold start", cold)) {
+        return 1;
+    }
+    const Buffer<float> v_cold = cold.v_new.copy();
+
+    const auto empty = ladmmSolverWarmStart(input, workspace, 0);
+    if (failed("Empty warm start", empty)) {
+        return 1;
+    }
+    if (empty.n_iter != 0 || !empty.r.empty()) {
+        std::cerr << "Empty warm start ran " << empty.n_iter << " iterations\n";
+        return 1;
+    }
+    if (!isIdentical(empty.v_new, v_cold)) {
+        std::cerr << "Empty warm start does not return the estimate of the previous solve\n";
+        return 1;
+    }
+
+    const auto result = ladmmSolverWarmStart(input, workspace, n_iter);
+    if (failed("Warm start", result)) {
+        return 1;
+    }
+
+    const bool identical = (result.n_iter == reference.n_iter) && (result.r == reference.r) &&
+                           (result.s == reference.s) &&
+                           isIdentical(result.v_new, reference.v_new);
+    std::cout << "Warm start after an empty solve: " << result.n_iter << " iterations, r = "
+              << result.r.back() << ", s = " << result.s.back()
+              << (identical ? "" : " (differs from the reference)") << '\n';
+
+    return identical ? 0 : 1;
+}
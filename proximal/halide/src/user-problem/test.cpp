@@ -8,6 +8,7 @@
 
 using Halide::Runtime::Buffer;
 using Halide::Tools::load_and_convert_image;
+using proximal::runtime::LadmmWorkspace;
 using proximal::runtime::ladmmSolver;
 
 namespace {
@@ -33,8 +34,18 @@ main() {
     Buffer<const float> normalized = std::move(raw_image);
 
     const auto max_n_iter = 50;
-    const auto [error_code, denoised, r, s, eps_pri, eps_dual] =
-        ladmmSolver(normalized, max_n_iter);
+
+    // Estimate the problem scaling factors from || K ||, instead of the hard-coded defaults.
+    LadmmWorkspace workspace{max_n_iter};
+    if (workspace.estimateScaling() != 0) {
+        std::cerr << "Failed to estimate || K ||\n";
+        return 1;
+    }
+    std::cout << "Estimated params [lambda = " << workspace.lmb_init
+              << " | mu = " << workspace.mu_init << "]\n";
+
+    const auto [error_code, denoised, r, s, eps_pri, eps_dual, n_iter, elapsed] =
+        ladmmSolver(normalized, workspace, max_n_iter);
 
     // TODO(Antony): use std::ranges::zip_view
     for (size_t i = 0; i < r.size(); i++) {
@@ -45,6 +56,7 @@ main() {
                   << '\n';
     }
 
+    std::cout << "Total iterations = " << n_iter << ", in " << elapsed * 1e3 << " ms\n";
     std::cout << "Top-left pixel = " << denoised(0, 0, 0) << '\n';
 
     Buffer<float> output = std::move(denoised);
@@ -7,6 +7,12 @@ from proximal.utils.utils import Impl, fftd, ifftd
 from scipy.sparse.linalg import lsqr, LinearOperator
 from proximal.halide.halide import Halide
 from proximal.utils.memoized_expr import memoized_expr
+import itertools
+
+# Unique handles of the K^T b vectors, for the frequency cache of the
+# Halide-accelerated prox_L2. A new handle is drawn whenever K^T b changes, for
+# the callers identifying b by its hash.
+_Ktb_handles = itertools.count()
 
 
 class sum_squares(ProxFn):
@@ -191,6 +197,10 @@ class least_squares(sum_squares):
                 self.K.adjoint(b.evaluate(), self.Ktb)
                 self.Ktb.setflags(write=False)
 
+                # Without the hash of b, Ktb may change in place; prox_L2
+                # then looks up its spectrum by the content hash instead.
+                self.Ktb_handle = next(_Ktb_handles) if hash is not None else None
+
                 self.b_hash = hash
 
         # KtK Operator is diagonal
@@ -230,6 +240,7 @@ class least_squares(sum_squares):
                         self.Ktb.reshape(self.freq_shape),
                         self.freq_diag,
                         ftmp_halide_out,
+                        self.Ktb_handle,
                     )
                 else:
                     Halide('prox_L2').prox_L2(
@@ -238,6 +249,7 @@ class least_squares(sum_squares):
                         np.reshape(v, self.freq_shape),
                         self.freq_diag.astype(np.complex64),
                         ftmp_halide_out,
+                        self.Ktb_handle,
                     )
 
                 return ftmp_halide_out.ravel()
@@ -1,10 +1,14 @@
+import importlib
+
 import numpy as np
+import pytest
 from scipy.datasets import ascent
 from scipy.signal import convolve2d
 
 import proximal as px
 from proximal.tests.base_test import BaseTest
 from proximal.halide.halide import Halide
+from proximal.prox_fns.sum_squares import cg
 
 class TestHalideOps(BaseTest):
     def test_configure(self):
@@ -78,3 +82,232 @@ class TestHalideOps(BaseTest):
 
     def test_hqs(self):
         self._test_algo(px.hqs)
+
+    def test_prox_L2_cache(self):
+        """ Frequency cache of prox_L2: hit, miss and eviction counters, and
+        new data at the address of a cached input.
+        """
+        np_img, _ = self._get_testvector()
+        Halide('prox_L2', recompile=True)
+        prox_L2 = importlib.import_module('proximal.halide.build.prox_L2')
+        prox_L2.cache_clear()
+
+        # With freq_diag = 1 and theta = 1, the solution is (input + offset) / 2.
+        freq_diag = np.ones(np_img.shape, dtype=np.complex64, order='F')
+        offset = np.zeros(np_img.shape, dtype=np.float32, order='F')
+        output = np.empty(np_img.shape, dtype=np.float32, order='F')
+
+        def solve(input, *handle):
+            Halide('prox_L2').prox_L2(input, 1.0, offset, freq_diag, output, *handle)
+            return output.copy()
+
+        def stats():
+            s = prox_L2.cache_stats()
+            return s['hits'], s['misses'], s['evictions'], s['entries']
+
+        input = np_img.copy(order='F')
+        self.assertItemsAlmostEqual(solve(input), input / 2, eps=1e-4)
+        self.assertEqual(stats(), (0, 1, 0, 1))
+
+        # Same data: the spectrum is read from the cache.
+        self.assertItemsAlmostEqual(solve(input), input / 2, eps=1e-4)
+        self.assertEqual(stats(), (1, 1, 0, 1))
+
+        # Same address, new data: must not return the stale spectrum.
+        input *= 0.5
+        self.assertItemsAlmostEqual(solve(input), input / 2, eps=1e-4)
+        self.assertEqual(stats(), (1, 2, 0, 2))
+
+        # Same data at a new address: hit.
+        self.assertItemsAlmostEqual(solve(input.copy(order='F')), input / 2, eps=1e-4)
+        self.assertEqual(stats(), (2, 2, 0, 2))
+
+        # Room for one spectrum only: the least recently used one is evicted.
+        entry_size = prox_L2.cache_stats()['size'] // 2
+        prox_L2.set_cache_capacity(entry_size)
+        self.assertEqual(stats(), (2, 2, 1, 1))
+
+        self.assertItemsAlmostEqual(solve(input), input / 2, eps=1e-4)
+        self.assertEqual(stats(), (3, 2, 1, 1))
+
+        # Problem handles are keyed apart from the content hashes.
+        self.assertItemsAlmostEqual(solve(input, 1), input / 2, eps=1e-4)
+        self.assertItemsAlmostEqual(solve(input, 1), input / 2, eps=1e-4)
+        self.assertEqual(stats(), (4, 3, 2, 1))
+
+        # Same bytes in another shape, padded to the same FFT size: miss.
+        block = np.asfortranarray(input[:input.shape[0] // 2, :])
+        solve(block)
+        self.assertEqual(stats(), (4, 4, 3, 1))
+        solve(block.reshape(block.shape[::-1], order='F'))
+        self.assertEqual(stats(), (4, 5, 4, 1))
+
+        prox_L2.set_cache_capacity(256 << 20)
+        prox_L2.cache_clear()
+
+    def _get_cg_problem(self):
+        """ Small masked deconvolution problem of the CG prox: the input image
+        xin, A^T b, the kernel K and M^T M of the mask M.
+        """
+        rng = np.random.default_rng(0)
+        np_img, K = self._get_testvector()
+
+        xin = np.asfortranarray(np_img[::8, ::8] / 255., dtype=np.float32)
+        mask = rng.random(xin.shape) > 0.3
+        MtM = np.asfortranarray(mask, dtype=np.float32)
+        Atb = np.asfortranarray(rng.random(xin.shape), dtype=np.float32)
+
+        return xin, Atb, K, MtM
+
+    def _cg_reference(self, Mfun, xin, Atb, beta):
+        """ Solve (beta A^T A + I) x = beta A^T b + xin by the NumPy CG, with
+        Mfun(x) = A^T A x.
+        """
+
+        def KtKfun(x, out):
+            out[:] = beta * Mfun(x) + x
+
+        rhs = (beta * Atb + xin).astype(np.float64)
+        return cg(KtKfun, rhs, 1e-8, 1000, False, x_init=xin.astype(np.float64))
+
+    def test_prox_CG_conv(self):
+        """ CG prox of convolution + mask, against the NumPy CG, and the early
+        exit at the relative tolerance.
+        """
+        xin, Atb, K, MtM = self._get_cg_problem()
+        beta = 10.0
+        max_iters = 200
+
+        def A(x):
+            return convolve2d(x, K, mode='same', boundary='wrap')
+
+        def At(x):
+            return convolve2d(x, K[::-1, ::-1], mode='same', boundary='wrap')
+
+        x_ref = self._cg_reference(lambda x: At(MtM * A(x)), xin, Atb, beta)
+
+        Halide('prox_CG_conv', recompile=True)
+        prox_CG_conv = importlib.import_module('proximal.halide.build.prox_CG_conv')
+
+        tol = 1e-4
+        output = np.empty(xin.shape, dtype=np.float32, order='F')
+        Halide('prox_CG_conv').prox_CG_conv(xin, Atb, K, MtM, beta, output,
+                                            max_iters, tol, 'none')
+        self.assertItemsAlmostEqual(output, x_ref, eps=1e-3)
+
+        # Stops as soon as the relative residual is below tol.
+        stats = prox_CG_conv.solve_stats()
+        assert 0 < stats['iterations'] < max_iters
+        assert stats['norm_r'] <= tol * stats['norm_r0']
+
+        # Runs max_iters steps when tol is never reached.
+        Halide('prox_CG_conv').prox_CG_conv(xin, Atb, K, MtM, beta, output, 3,
+                                            0.0, 'none')
+        self.assertEqual(prox_CG_conv.solve_stats()['iterations'], 3)
+
+    def test_prox_CG_warp(self):
+        """ CG prox of warp + mask, against the NumPy CG with the warp
+        operators A_warp and At_warp, and the early exit at the relative
+        tolerance.
+        """
+        xin, Atb, _, MtM = self._get_cg_problem()
+        beta = 10.0
+        max_iters = 200
+
+        theta_rad = 5.0 * np.pi / 180.0
+        H = np.array([[np.cos(theta_rad), -np.sin(theta_rad), 4.],
+                      [np.sin(theta_rad), np.cos(theta_rad), 0.], [0., 0., 1.]],
+                     dtype=np.float32,
+                     order='F')
+        Hinv = np.asfortranarray(np.linalg.pinv(H))
+
+        Halide('A_warp', recompile=True)
+        Halide('At_warp', recompile=True)
+        warped = np.empty((*xin.shape, 1, 1), dtype=np.float32, order='F')
+        AtA_x = np.empty(xin.shape, dtype=np.float32, order='F')
+
+        def AtA(x):
+            Halide('A_warp').A_warp(np.asfortranarray(x, dtype=np.float32), H, warped)
+            warped[:, :, 0, 0] *= MtM
+            Halide('At_warp').At_warp(warped, Hinv, AtA_x)
+            return AtA_x
+
+        x_ref = self._cg_reference(AtA, xin, Atb, beta)
+
+        Halide('prox_CG_warp', recompile=True)
+        prox_CG_warp = importlib.import_module('proximal.halide.build.prox_CG_warp')
+
+        tol = 1e-4
+        output = np.empty(xin.shape, dtype=np.float32, order='F')
+        Halide('prox_CG_warp').prox_CG_warp(xin, Atb, H, Hinv, MtM, beta, output,
+                                            max_iters, tol)
+        self.assertItemsAlmostEqual(output, x_ref, eps=1e-3)
+
+        stats = prox_CG_warp.solve_stats()
+        assert 0 < stats['iterations'] < max_iters
+        assert stats['norm_r'] <= tol * stats['norm_r0']
+
+    def test_prox_CG_conv_precond(self):
+        """ Preconditioners of the CG prox of convolution + mask: same solution
+        as without preconditioner, in no more iterations on a badly
+        conditioned mask, and the circulant one only for the precompiled FFT
+        plans.
+        """
+        np_img, _ = self._get_testvector()
+        K = np.asfortranarray(np.outer(np.hanning(9), np.hanning(9)), dtype=np.float32)
+        K /= K.sum()
+        beta = 100.0
+        tol = 1e-4
+        max_iters = 1000
+
+        Halide('prox_CG_conv', recompile=True)
+        prox_CG_conv = importlib.import_module('proximal.halide.build.prox_CG_conv')
+
+        # Smallest image size of the precompiled FFT plans, for the circulant
+        # preconditioner.
+        sizes = [tuple(size) for size in prox_CG_conv.sizes]
+        height, width = min(sizes, key=np.prod)
+        xin = np.tile(np_img / 255., (height // np_img.shape[0] + 1,
+                                      width // np_img.shape[1] + 1))[:height, :width]
+        xin = np.asfortranarray(xin, dtype=np.float32)
+
+        # Vignetting mask with a dark corner.
+        yy, xx = np.meshgrid(np.linspace(0, 1, height), np.linspace(0, 1, width),
+                             indexing='ij')
+        mask = np.exp(-4.0 * (xx**2 + yy**2))
+        MtM = np.asfortranarray(mask * mask, dtype=np.float32)
+
+        blurred = convolve2d(xin, K, mode='same', boundary='wrap')
+        b = mask * (blurred + 0.01 * np.random.default_rng(0).standard_normal(xin.shape))
+        Atb = np.asfortranarray(
+            convolve2d(mask * b, K[::-1, ::-1], mode='same', boundary='wrap'),
+            dtype=np.float32)
+
+        def solve(preconditioner, x=xin, Atb=Atb, MtM=MtM):
+            output = np.empty(x.shape, dtype=np.float32, order='F')
+            Halide('prox_CG_conv').prox_CG_conv(x, Atb, K, MtM, beta, output,
+                                                max_iters, tol, preconditioner)
+            return output, prox_CG_conv.solve_stats()['iterations']
+
+        output_ref, n_iter_ref = solve('none')
+        assert n_iter_ref < max_iters
+
+        for preconditioner in ('jacobi', 'circulant'):
+            output, n_iter = solve(preconditioner)
+            self.assertItemsAlmostEqual(output, output_ref, eps=1e-3)
+            assert n_iter <= n_iter_ref, preconditioner
+
+        # Without a precompiled FFT plan, only the circulant preconditioner fails.
+        height_unplanned = height + 2
+        while (height_unplanned, width) in sizes:
+            height_unplanned += 2
+
+        def pad(a):
+            return np.asfortranarray(
+                np.pad(a, ((0, height_unplanned - height), (0, 0)), mode='wrap'))
+
+        x, Atb_unplanned, MtM_unplanned = pad(xin), pad(Atb), pad(MtM)
+
+        solve('jacobi', x, Atb_unplanned, MtM_unplanned)
+        with pytest.raises(ValueError):
+            solve('circulant', x, Atb_unplanned, MtM_unplanned)
@@ -1,3 +1,4 @@
+import importlib
 import os
 from scipy import signal
 from scipy import ndimage
@@ -185,6 +186,108 @@ class TestLinOps(BaseTest):
         self.assertItemsAlmostEqual(output, output_ref)
         self.assertItemsAlmostEqual(output_corr, output_corr_ref)
 
+    def test_conv_methods_halide(self):
+        """Test each convolution method of A_conv and At_conv against the
+        direct one, and the adjointness of A_conv and At_conv.
+        """
+        np_img = get_test_image(512)
+        K = get_kernel(15, np_img.ndim)
+
+        A = Halide('A_conv', recompile=True)
+        At = Halide('At_conv', recompile=True)
+        A_launch = importlib.import_module('proximal.halide.build.A_conv')
+        At_launch = importlib.import_module('proximal.halide.build.At_conv')
+
+        def apply(method):
+            A_launch.set_method(method)
+            At_launch.set_method(method)
+
+            output = np.zeros_like(np_img)
+            output_corr = np.zeros_like(np_img)
+            A.A_conv(np_img, K, output)
+            At.At_conv(np_img, K, output_corr)
+            return output, output_corr
+
+        try:
+            output_ref, output_corr_ref = apply('direct')
+
+            for method in ('separable', 'fft', 'auto'):
+                output, output_corr = apply(method)
+                self.assertItemsAlmostEqual(output, output_ref)
+                self.assertItemsAlmostEqual(output_corr, output_corr_ref)
+
+                # < A x, y > = < x, A^T y >
+                x = np.asfortranarray(np.random.rand(*np_img.shape),
+                                      dtype=np.float32)
+                y = np.asfortranarray(np.random.rand(*np_img.shape),
+                                      dtype=np.float32)
+                Ax = np.zeros_like(x)
+                Aty = np.zeros_like(y)
+                A.A_conv(x, K, Ax)
+                At.At_conv(y, K, Aty)
+                self.assertAlmostEqual(np.vdot(Ax, y) / np.vdot(x, Aty), 1.0,
+                                       eps=1e-4)
+        finally:
+            A_launch.set_method('auto')
+            At_launch.set_method('auto')
+
+    def test_conv_separable_halide(self):
+        """Test the separable convolution of A_conv and At_conv against the
+        direct one, for an exactly and a nearly separable kernel.
+        """
+        np_img = get_test_image(512)
+
+        # Normalized Gaussian of rank 1.
+        g = signal.windows.gaussian(15, 2.0)
+        K_separable = np.asfortranarray(np.outer(g, g) / np.sum(g)**2,
+                                        dtype=np.float32)
+
+        # Perturbation of about 0.1% of the kernel, of full rank.
+        rng = np.random.default_rng(0)
+        K_nearly = np.asfortranarray(
+            K_separable * (1 + 1e-3 * rng.standard_normal(K_separable.shape)),
+            dtype=np.float32)
+
+        A = Halide('A_conv', recompile=True)
+        At = Halide('At_conv', recompile=True)
+        A_launch = importlib.import_module('proximal.halide.build.A_conv')
+        At_launch = importlib.import_module('proximal.halide.build.At_conv')
+
+        def apply(K, method):
+            A_launch.set_method(method)
+            At_launch.set_method(method)
+
+            output = np.zeros_like(np_img)
+            output_corr = np.zeros_like(np_img)
+            A.A_conv(np_img, K, output)
+            At.At_conv(np_img, K, output_corr)
+            return output, output_corr
+
+        try:
+            self.assertEqual(A_launch.rank(K_separable), 1)
+            self.assertEqual(At_launch.rank(K_separable), 1)
+
+            output_ref, output_corr_ref = apply(K_separable, 'direct')
+            output, output_corr = apply(K_separable, 'separable')
+            self.assertItemsAlmostEqual(output, output_ref)
+            self.assertItemsAlmostEqual(output_corr, output_corr_ref)
+
+            # The tolerance is shared by A_conv and At_conv.
+            A_launch.set_separable_tolerance(1e-2)
+            self.assertEqual(At_launch.cost_model()['separable_tolerance'],
+                             1e-2)
+            self.assertEqual(A_launch.rank(K_nearly), 1)
+            self.assertEqual(At_launch.rank(K_nearly), 1)
+
+            output_ref, output_corr_ref = apply(K_nearly, 'direct')
+            output, output_corr = apply(K_nearly, 'separable')
+            self.assertItemsAlmostEqual(output, output_ref, eps=1e-2)
+            self.assertItemsAlmostEqual(output_corr, output_corr_ref, eps=1e-2)
+        finally:
+            A_launch.set_separable_tolerance(1e-6)
+            A_launch.set_method('auto')
+            At_launch.set_method('auto')
+
     def vstack(self):
         """Test vstack operator.
         """
@@ -505,3 +608,93 @@ class TestLinOps(BaseTest):
                                                borderValue=0.)
 
         self.assertItemsAlmostEqual(output_trans, output_ref_trans, eps=1e-1)
+
+    def test_AtA_halide(self):
+        """Test the fused AtA_conv, AtA_mask and AtA_warp in halide against
+        At_*(MtM * A_*(x)).
+        """
+        np_img = get_test_image(512)
+        mask = np.asfortranarray(np.random.rand(*np_img.shape),
+                                 dtype=np.float32)
+        MtM = np.asfortranarray(mask * mask)
+
+        tmp = np.zeros_like(np_img)
+        output_ref = np.zeros_like(np_img)
+        output = np.zeros_like(np_img)
+
+        # Mask
+        Halide('A_mask', recompile=True).A_mask(np_img, mask, tmp)
+        Halide('At_mask', recompile=True).At_mask(tmp, mask, output_ref)
+        Halide('AtA_mask', recompile=True).AtA_mask(np_img, mask, output)
+        self.assertItemsAlmostEqual(output, output_ref)
+
+        # Convolution
+        K = get_kernel(11, np_img.ndim)
+        Halide('A_conv', recompile=True).A_conv(np_img, K, tmp)
+        Halide('At_conv', recompile=True).At_conv(
+            np.asfortranarray(MtM * tmp), K, output_ref)
+        Halide('AtA_conv', recompile=True).AtA_conv(np_img, K, MtM, output)
+        self.assertItemsAlmostEqual(output, output_ref)
+
+        # Warp
+        theta_rad = 5.0 * np.pi / 180.0
+        H = np.array([[np.cos(theta_rad), -np.sin(theta_rad), -128.],
+                      [np.sin(theta_rad), np.cos(theta_rad), 0.], [0., 0., 1.]],
+                     dtype=np.float32,
+                     order='F')
+        Hinv = np.asfortranarray(np.linalg.pinv(H))
+
+        warped = np.zeros((*np_img.shape, 1, 1), dtype=np.float32, order='F')
+        Halide('A_warp', recompile=True).A_warp(np_img, H, warped)
+        warped[:, :, 0, 0] *= MtM
+        Halide('At_warp', recompile=True).At_warp(warped, Hinv, output_ref)
+        Halide('AtA_warp', recompile=True).AtA_warp(np_img, H, Hinv, MtM,
+                                                    output)
+        self.assertItemsAlmostEqual(output, output_ref)
+
+    def test_conv_sv_halide(self):
+        """Test spatially varying convolution in halide against the sum of
+        A_conv on the weighted images, and the adjointness of A_conv_sv and
+        At_conv_sv.
+        """
+        np_img = get_test_image(256)
+
+        # Grid of 2 x 2 kernels, blended by bilinear weights.
+        K = np.stack([
+            get_kernel(9, 2),
+            np.rot90(get_kernel(9, 2)),
+            np.full((9, 9), 1.0 / 81),
+            np.eye(9) / 9,
+        ], axis=2)
+        K = np.asfortranarray(K, dtype=np.float32)
+
+        yy, xx = np.meshgrid(np.linspace(0, 1, np_img.shape[0]),
+                             np.linspace(0, 1, np_img.shape[1]),
+                             indexing='ij')
+        W = np.stack([(1 - xx) * (1 - yy), xx * (1 - yy), (1 - xx) * yy, xx * yy],
+                     axis=2)
+        W = np.asfortranarray(W, dtype=np.float32)
+
+        # Sum of the per-kernel convolutions
+        output_ref = np.zeros_like(np_img)
+        tmp = np.zeros_like(np_img)
+        A_conv = Halide('A_conv', recompile=True)
+        for k in range(K.shape[2]):
+            A_conv.A_conv(np.asfortranarray(np_img * W[..., k]),
+                          np.asfortranarray(K[..., k]), tmp)
+            output_ref += tmp
+
+        output = np.zeros_like(np_img)
+        A = Halide('A_conv_sv', recompile=True)
+        A.A_conv_sv(np_img, K, W, output)
+        self.assertItemsAlmostEqual(output, output_ref)
+
+        # < A x, y > = < x, A^T y >
+        At = Halide('At_conv_sv', recompile=True)
+        x = np.asfortranarray(np.random.rand(*np_img.shape), dtype=np.float32)
+        y = np.asfortranarray(np.random.rand(*np_img.shape), dtype=np.float32)
+        Ax = np.zeros_like(x)
+        Aty = np.zeros_like(y)
+        A.A_conv_sv(x, K, W, Ax)
+        At.At_conv_sv(y, K, W, Aty)
+        self.assertAlmostEqual(np.vdot(Ax, y) / np.vdot(x, Aty), 1.0, eps=1e-4)